@@ -0,0 +1,116 @@
+#ifndef SERIALFRAME_H
+#define	SERIALFRAME_H
+
+#include <stdint.h>
+
+/*
+ * Binary framing for the Arduino link, the alternative to the comma separated
+ * text lines. Every frame is
+ *
+ *   0xA5 0x5A | version | type | length | sequence | payload | CRC16
+ *
+ * where length counts the payload bytes only and the CRC (CCITT, 0xFFFF start,
+ * low byte first) covers version through payload. Multi byte payload values are
+ * little endian, as both ends already are.
+ *
+ * FrameDecoder takes the serial stream in whatever pieces read() returns and
+ * decodes each good frame straight into the preallocated struct for its type.
+ * A frame with a bad CRC, length or version is counted and dropped, and the
+ * decoder hunts for the next sync pair from the byte after its first sync
+ * byte, so a frame hidden inside the bad one is still found.
+ */
+
+namespace serial_frame {
+
+const uint8_t SYNC1 = 0xA5;
+const uint8_t SYNC2 = 0x5A;
+const uint8_t VERSION = 1;
+
+const int HEADER_SIZE = 6;
+const int CRC_SIZE = 2;
+const int MAX_PAYLOAD = 48;
+const int MAX_FRAME = HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE;
+
+// Arduino to abridge
+const uint8_t IMU = 0x01;
+const uint8_t ODOM = 0x02;
+const uint8_t SONAR = 0x03;
+const uint8_t GRIPPER = 0x04;
+
+// abridge to Arduino
+const uint8_t DRIVE = 0x10;
+const uint8_t FINGER = 0x11;
+const uint8_t WRIST = 0x12;
+const uint8_t DATA_REQUEST = 0x13;
+
+// same units as the text protocol
+struct Imu {
+    float acceleration[3];
+    float angularVelocity[3];
+    float roll, pitch, yaw;
+};
+
+struct Odom {
+    float dx, dy;        // centimeters since the last report
+    float theta;         // radians
+    float vx, vy;        // centimeters per second
+    float angularVelocity;
+};
+
+struct Sonar {
+    float left, center, right; // centimeters
+};
+
+struct Gripper {
+    float finger, wrist; // radians
+};
+
+struct Drive {
+    int16_t left, right; // PWM, -255 to 255
+};
+
+uint16_t crc16(const uint8_t* data, int length);
+
+// writes a frame to out, which must hold MAX_FRAME bytes; returns its size
+int encode(uint8_t type, uint8_t sequence, const void* payload, int length, uint8_t* out);
+
+class FrameDecoder {
+public:
+
+    // bits of updated
+    static const int IMU_UPDATED = 1, ODOM_UPDATED = 2, SONAR_UPDATED = 4, GRIPPER_UPDATED = 8;
+
+    FrameDecoder();
+
+    // decodes as much of data as makes up whole frames, and keeps the rest
+    // for the next call; returns the IMU_UPDATED... bits for what came in
+    int feed(const uint8_t* data, int length);
+
+    Imu imu;
+    Odom odom;
+    Sonar sonar;
+    Gripper gripper;
+
+    // running totals
+    unsigned long frames;
+    unsigned long crcErrors;
+    unsigned long lengthErrors;    // too long, or wrong for the type
+    unsigned long versionErrors;
+    unsigned long unknownTypes;
+    unsigned long droppedBytes;    // skipped while looking for a sync pair
+    unsigned long sequenceGaps;    // frames the sequence numbers say we missed
+
+private:
+
+    int deliver();
+    int rescan();
+
+    uint8_t frame[MAX_FRAME];
+    int received;
+    int expected;
+    int lastSequence;
+};
+
+}
+
+#endif	/* SERIALFRAME_H */
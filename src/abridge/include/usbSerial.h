@@ -9,6 +9,8 @@
 #include <unistd.h>  
 #include <fcntl.h>   
 #include <termios.h> 
+#include <stdint.h>
+#include <poll.h>
 
 using namespace std;
 
@@ -19,16 +21,42 @@ public:
     virtual ~USBSerial();
   
     void openUSBPort(string devicePath, int baud);
-    void sendData(char data[]);
+    //writes length bytes, waiting for the port if it cannot take them at once; returns the bytes written
+    int sendData(const char* data, int length);
+    //every complete line received so far; a partial line stays buffered
     string readData();
+    //takes up to size buffered bytes, whole frames or not
+    int readBytes(uint8_t* buffer, int size);
     void closeUSBPort();
 
+    //waits up to timeout milliseconds for the port to become readable
+    bool waitForData(int timeout);
+    //moves whatever the port has into the receive buffer; returns the byte count
+    int fill();
+    //takes the next complete line, without its newline, if there is one
+    bool readLine(string& line);
+
+    //running totals
+    unsigned long bytesReceived;
+    unsigned long overflowBytes; //oldest bytes dropped because the buffer was full
+    unsigned long overlongLines; //lines longer than maxLine, dropped
+    unsigned long readErrors;
+    unsigned long writeErrors;
+
+    static const int bufferSize = 4096;
+    static const int maxLine = 200;
+
 private:
 
+    int buffered() const { return (head - tail + bufferSize) % bufferSize; }
+
     struct termios ioStruct;
     int usbFileDescriptor;
-    char serialDataIn[200];
-    char dataOut[16];
+
+    //receive ring buffer, written at head and read at tail
+    uint8_t ring[bufferSize];
+    int head;
+    int tail;
 
 };
 
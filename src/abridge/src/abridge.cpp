@@ -13,9 +13,13 @@
 #include <sensor_msgs/Imu.h>
 #include <sensor_msgs/Range.h>
 #include <std_msgs/UInt8.h>
+#include <std_msgs/UInt32MultiArray.h>
+#include <std_msgs/Float32MultiArray.h>
 
 //Package include
 #include <usbSerial.h>
+#include <serialFrame.h>
+#include <pid_controller/DriveController.h>
 
 using namespace std;
 
@@ -25,9 +29,25 @@ void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle);
 void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle);
 void serialActivityTimer(const ros::TimerEvent& e);
 void publishRosTopics();
-void parseData(string data);
+int parseData(string data, ros::Time received);
+void readSerial();
+void applyFrames(int updated, ros::Time received);
+void serialReportTimer(const ros::TimerEvent& e);
+void flushCommands();
 std::string getHumanFriendlyTime();
 
+//the latest command of each kind waiting for the next write; a newer one
+//replaces one that has not gone out yet
+struct PendingCommand {
+    bool queued;
+    ros::Time since;   //when the newest setpoint arrived
+    uint8_t type;      //serial_frame type, for the binary protocol
+    char data[serial_frame::MAX_PAYLOAD]; //text line, or frame payload
+    int length;
+};
+
+void queueCommand(PendingCommand& command, uint8_t type, const void* data, int length);
+
 //Globals
 geometry_msgs::QuaternionStamped fingerAngle;
 geometry_msgs::QuaternionStamped wristAngle;
@@ -41,27 +61,58 @@ const int baud = 115200;
 char dataCmd[] = "d\n";
 char moveCmd[16];
 char host[128];
-const float deltaTime = 0.1; //abridge's update interval
+//how often the Arduino is asked for data; ~requestRate can raise it up to
+//maxRequestRate, about what a full text reply allows at 115200 baud
+float requestRate = 10;
+const float maxRequestRate = 50;
 int currentMode = 0;
 string publishedName;
 
-
-//PID constants and arrays
-const int histArrayLength = 1000;
-
-float velFF = 0; //velocity feed forward
-int stepV = 0; //keeps track of the point in the evArray for adding new error each update cycle.
-float evArray[histArrayLength]; //history array of previous error for (arraySize/hz) seconds (error Velocity Array)
-float velError[4] = {0,0,0,0}; //contains current velocity error and error 3 steps in the past.
-
-int stepY = 0; //keeps track of the point in the eyArray for adding new error each update cycle.
-float eyArray[histArrayLength]; //history array of previous error for (arraySize/hz) seconds (error Yaw Array)
-float yawError[4] = {0,0,0,0}; //contains current yaw error and error 3 steps in the past.
-
-float prevLin = 0;
-float prevYaw = 0;
-
-ros::Time prevDriveCommandUpdateTime;
+//with ~binaryProtocol the Arduino link uses serial_frame frames instead of
+//comma separated text lines
+bool binaryProtocol = false;
+serial_frame::FrameDecoder frameDecoder;
+uint8_t frameSequence = 0;
+uint8_t serialBuffer[512];
+unsigned long malformedLines = 0; //text lines that could not be parsed
+
+//sensors heard from since the last data request, as FrameDecoder bits, and
+//how many requests each sensor has gone unanswered for
+int sensorsUpdated = 0;
+bool requestOutstanding = false;
+const int numSensors = 4; //imu, odom, sonar, gripper
+unsigned long samplesMissed[numSensors] = {0, 0, 0, 0};
+int serialPollTimeout = 10; //milliseconds, between ROS callback passes
+
+//stamps of the last message sent on each topic, so one is only published
+//again once a newer sample has been received
+ros::Time fingerAnglePublished;
+ros::Time wristAnglePublished;
+ros::Time imuPublished;
+ros::Time odomPublished;
+ros::Time sonarLeftPublished;
+ros::Time sonarCenterPublished;
+ros::Time sonarRightPublished;
+
+PendingCommand driveCommand;
+PendingCommand fingerCommand;
+PendingCommand wristCommand;
+PendingCommand dataRequest;
+
+//outbound totals since the last report
+struct CommandStats {
+    unsigned long bytes;
+    unsigned long writes;
+    unsigned long coalesced; //setpoints replaced before they were sent
+    unsigned long commands;
+    double latencySum;       //seconds from setpoint to write
+    double latencyMax;
+};
+CommandStats commandStats;
+
+
+//drive loop, tuned with the ~velocity* and ~yaw* params
+DriveController driveController;
 
 //Publishers
 ros::Publisher fingerAnglePublish;
@@ -72,6 +123,8 @@ ros::Publisher sonarLeftPublish;
 ros::Publisher sonarCenterPublish;
 ros::Publisher sonarRightPublish;
 ros::Publisher infoLogPublisher;
+ros::Publisher serialErrorsPublish;
+ros::Publisher serialCommandsPublish;
 
 //Subscribers
 ros::Subscriber driveControlSubscriber;
@@ -81,6 +134,7 @@ ros::Subscriber modeSubscriber;
 
 //Timers
 ros::Timer publishTimer;
+ros::Timer errorTimer;
 
 int main(int argc, char **argv) {
     
@@ -91,6 +145,11 @@ int main(int argc, char **argv) {
     ros::NodeHandle param("~");
     string devicePath;
     param.param("device", devicePath, string("/dev/ttyUSB0"));
+    param.param("binaryProtocol", binaryProtocol, binaryProtocol);
+    param.param("serialPollTimeout", serialPollTimeout, serialPollTimeout);
+    param.param("requestRate", requestRate, requestRate);
+    if (requestRate > maxRequestRate) requestRate = maxRequestRate;
+    if (requestRate <= 0) requestRate = 10;
     usb.openUSBPort(devicePath, baud);
     void modeHandler(const std_msgs::UInt8::ConstPtr& message);
     
@@ -114,6 +173,8 @@ int main(int argc, char **argv) {
     sonarCenterPublish = aNH.advertise<sensor_msgs::Range>((publishedName + "/sonarCenter"), 10);
     sonarRightPublish = aNH.advertise<sensor_msgs::Range>((publishedName + "/sonarRight"), 10);
     infoLogPublisher = aNH.advertise<std_msgs::String>("/infoLog", 1, true);
+    serialErrorsPublish = aNH.advertise<std_msgs::UInt32MultiArray>((publishedName + "/serialErrors"), 1, true);
+    serialCommandsPublish = aNH.advertise<std_msgs::Float32MultiArray>((publishedName + "/serialCommands"), 1, true);
     
     driveControlSubscriber = aNH.subscribe((publishedName + "/driveControl"), 10, driveCommandHandler);
     fingerAngleSubscriber = aNH.subscribe((publishedName + "/fingerAngle/cmd"), 1, fingerAngleHandler);
@@ -121,291 +182,51 @@ int main(int argc, char **argv) {
     modeSubscriber = aNH.subscribe((publishedName + "/mode"), 1, modeHandler);
 
     
-    publishTimer = aNH.createTimer(ros::Duration(deltaTime), serialActivityTimer);
+    publishTimer = aNH.createTimer(ros::Duration(1.0 / requestRate), serialActivityTimer);
+    errorTimer = aNH.createTimer(ros::Duration(1.0), serialReportTimer);
     
     imu.header.frame_id = publishedName+"/base_link";
     
     odom.header.frame_id = publishedName+"/odom";
     odom.child_frame_id = publishedName+"/base_link";
 
-    for (int i = 0; i < histArrayLength; i++)
-    {
-    evArray[i] = 0;
-    eyArray[i] = 0;
-    }
-    
-    prevDriveCommandUpdateTime = ros::Time::now();
+    driveController = DriveController(param);
 
-    ros::spin();
+    //read the port as soon as it has data rather than once per timer tick,
+    //and run the ROS callbacks in between
+    while (ros::ok()) {
+        if (usb.waitForData(serialPollTimeout)) readSerial();
+        ros::spinOnce();
+        flushCommands();
+    }
     
     return EXIT_SUCCESS;
 }
 
 //This command handler recives a linear velocity setpoint and a angular yaw error
-//and produces a command output for the left and right motors of the robot.
-//See the following paper for description of PID controllers.
-//Bennett, Stuart (November 1984). "Nicholas Minorsky and the automatic steering of ships". IEEE Control Systems Magazine. 4 (4): 10–15. doi:10.1109/MCS.1984.1104827. ISSN 0272-1708.
+//and produces a command output for the left and right motors of the robot,
+//through the drive loop sbridge runs too.
 void driveCommandHandler(const geometry_msgs::Twist::ConstPtr& message) {
-   
-  // ********************************************************* 
-  // Change these six values to tune the PID.  
-  // *********************************************************
-  float Kpv = 140; //Proportinal Velocity
-  float Kiv = 20; //Integral Velocity
-  float Kdv = 15; //Derivative Velocity
-  
-  float Kpy = 200; //Proportinal Yaw   
-  float Kiy = 15; //Inegral Yaw
-  float Kdy = 15; //Derivative Yaw
-  
-    
-  // ********************************************************  
-    
-  float hz = 10; //This is the design frequency of the PID and if the update rate in mobility is changed this will have to
-                  //change to match as well as all tuning values.
-  float linearSpeed = 0.;
-  linearSpeed = (message->linear.x); //target linear velocity in meters per second
-  yawError[0] = (message->angular.z); //angular error in radians
+  float linearSpeed = message->linear.x; //target linear velocity in meters per second
+  float yawError = message->angular.z; //angular error in radians
 
   float xVel = odom.twist.twist.linear.x;
   float yVel = odom.twist.twist.linear.y;
   float vel = sqrt(xVel*xVel + yVel*yVel);
-  
-  float PV = 0; //proportional velocity output 
-  float IV = 0; //Integral velocity output
-  float DV = 0; //Derivative velocity output
-  
-  float PY = 0; //proportional yaw output 
-  float IY = 0; //Integral yaw output
-  float DY = 0; //Derivative yaw output
-  
-  float sat = 255; //Saturation point
-  float velIntegralDeadspace = 0.01;
-  float yawIntegralDeadspace = 0.1;
-  
-  
-  if (!(linearSpeed == prevLin)) //if linear velocity setpoint changes reset integral and history to zero
-  {
-     for (int i= 0; i < histArrayLength; i++)
-     {
-       evArray[i] = 0;
-     }   
-     velError[0] = 0;
-     velError[1] = 0;
-     velError[2] = 0;
-     velError[3] = 0;
-     prevLin = linearSpeed; 
-   }
-   
-  //if yaw error setpoint changes reset yaw integral and yaw-error history to zero
-  if (prevYaw > 0 && yawError[0] < 0 || prevYaw < 0 && yawError > 0) 
-  {
-     for (int i= 0; i < histArrayLength; i++)
-     {
-       eyArray[i] = 0;
-     } 
-     yawError[1] = 0;
-     yawError[2] = 0;
-     yawError[3] = 0;
-     prevYaw = yawError[0];
-  }  
-   std::string getHumanFriendlyTime();
-
-  if (currentMode == 1) //manual control
-  {
-	yawError[0] *= 255/Kpy;
-	velError[0] = linearSpeed * 255/Kpv; //scale values between -255 and 255;
-  }
-  else //auto control
-  {
-    //Feed Forward command
-    //this is a direct mapping of commanded linear velocity to a PWM (Pulse Width Modulation) value command for the motors
-    if (linearSpeed > 0.5) velFF = 255;
-    else if (linearSpeed > 0.4) velFF = 180;
-    else if (linearSpeed > 0.3) velFF = 130;
-    else if (linearSpeed > 0.2) velFF = 75;
-    else if (linearSpeed > 0.1) velFF = 40;
-    else if (linearSpeed > 0.0) velFF = 10;
-
-    velError[0] = linearSpeed - vel; //calculate the error
-  }
-  
-  
-  // ----- BEGIN PID CONTROLLER CODE -----
-
-  
-  //Velocity--------------------------
-
-  
-  //Proportional
-  PV = Kpv * ((velError[0]+velError[1])/2);  //this is the proportional output
-  if (PV > sat) //limit the max and minimum output of proportional
-  PV = sat;
-  if (PV < -sat)
-  PV = -sat; 
-  
-  //Integral
-  //only use integral when error is larger than presumed noise.
-  if (velError[0] > velIntegralDeadspace || velError[0] < -velIntegralDeadspace)
-  {
-    evArray[stepV] = velError[0]; //add error into the error Array.
-    stepV++;
-    
-    if (stepV >= histArrayLength) stepV = 0;
-
-  }//deadzone ends here use integrel even without error as we have constant motion and drag.
-    
-    float sumV= 0;
-    for (int i= 0; i < histArrayLength; i++) //sum the array to get the error over time from t = 0 to present.
-    {
-        sumV += evArray[i];
-    }
-    
-    IV = Kiv * sumV; //this is integrated output
-     
-    //anti windup 
-    //anti windup reduces overshoot by limiting the acting time of the integral to areas where the 
-    //proportional term is less than half its saturation point.           
-    
-    //if PV is already commanding greater than half max PWM dont use the integral       
-    if (fabs(IV) > sat/2 || fabs(PV) > sat/2) //reset the integral to 0 if it hits its cap of half max PWM
-    {
-       for (int i= 0; i < histArrayLength; i++)
-        {
-           evArray[i] = 0;
-        }            
-        IV = 0;
-    }
 
-    //Derivative
-    if (!(fabs(PV) > sat/2)) 
-    {
-       //10 being the frequency of the system giving us a one second prediction base.
-       //calculates the derivative of the error using average of last 2 error values for current error
-       //and average of error 2 and 3 steps in the past as previouse error
-       DV = Kdv * ((velError[0]+velError[1])/2 - (velError[2]+velError[3])/2) * hz; 
-    }
-    velError[3] = velError[2];
-    velError[2] = velError[1];
-    velError[1] = velError[0]; //set previouse error to current error 
-    
-    float velOut = PV + IV + DV + velFF;
-    if (velOut > sat) //cap vel command
-    {
-        velOut = sat;
-    }
-    else if (velOut < -sat)
-    {
-        velOut = -sat;
-    }
-  
-    
-  //Yaw-----------------------------
-    
+  int left, right;
+  driveController.update(linearSpeed, yawError, vel, currentMode == 1, left, right);
 
-  //Proportional
-  PY = Kpy * ((yawError[0]+yawError[1])/2);  //this is the proportional output
-  if (PY > sat) //limit the max and minimum output of proportional
-  PY = sat;
-  if (PY < -sat)
-  PY = -sat; 
-  
-  //Integral
-  //only use integral when error is larger than presumed noise.
-  if (yawError[0] > yawIntegralDeadspace || yawError[0] < -yawIntegralDeadspace)
-  {
-    evArray[stepV] = velError[0]; //add error into the error Array.
-    stepV++;
-    
-    if (stepY >= histArrayLength) stepY = 0;
-    
-    float sumY= 0;
-    for (int i= 0; i < histArrayLength; i++) //sum the array to get the error over time from t = 0 to present.
-    {
-        sumY += eyArray[i];
+    if (binaryProtocol) {
+        serial_frame::Drive drive;
+        drive.left = left;
+        drive.right = right;
+        queueCommand(driveCommand, serial_frame::DRIVE, &drive, sizeof (drive));
+        return;
     }
-    
-    IY = Kiy * sumY; //this is integrated output
 
-   }//deadzone ends here use integrel only with error as there is no force to disturb our heading.
-     
-
-    //anti windup 
-    //anti windup reduces overshoot by limiting the acting time of the integral to areas where the 
-    //proportional term is less than half its saturation point.           
-    
-    //if PY is already commanding greater than half max PWM dont use the integral       
-    if (fabs(IY) > sat/2 || fabs(PY) > sat/2) //reset the integral to 0 if it hits its cap of half max PWM
-    {
-       for (int i= 0; i < histArrayLength; i++)
-        {
-           eyArray[i] = 0;
-        }            
-        IY = 0;
-    }
-
-    //Derivative
-    if (!(fabs(PY) > sat/2)) 
-    {
-       //10 being the frequency of the system giving us a one second prediction base.
-       //calculates the derivative of the error using average of last 2 error values for current error
-       //and average of error 2 and 3 steps in the past as previouse error
-       DY = Kdy * ((yawError[0]+yawError[1])/2 - (yawError[2]+yawError[3])/2) * hz; 
-    }
-    yawError[3] = yawError[2];
-    yawError[2] = yawError[1];
-    yawError[1] = yawError[0]; //set previouse error to current error 
-    
-    float yawOut = PY + IY + DY;
-    
-    //cap yaw command
-    if (yawOut > sat/2) {
-        yawOut = sat/2;
-    }
-    else if (yawOut < -sat/2) {
-        yawOut = -sat/2;
-    }
-
-    if (linearSpeed > 0 && velOut < 0) {
-	   velOut = 0;
-	}
-    else if(linearSpeed < 0 && velOut > 0) {
-	   velOut = 0;
-	}
-	 
-    if (PY > 0 && yawOut < 0)
-	{
-	   yawOut = 0;
-	}
-    else if(PY < 0 && yawOut > 0) {
-	   yawOut = 0;
-	}
-
-
-    // ----- END PID CONTROLLER CODE -----
-
-    if (currentMode == 1) {
-	    yawOut = PY;
-	    velOut = PV;	
-  	}
-   
-   int left = velOut - yawOut;
-   int right = velOut + yawOut;
-   
-   if (left  >  sat) {left  =  sat;}
-   if (left  < -sat) {left  = -sat;}
-   if (right >  sat) {right =  sat;}
-   if (right < -sat) {right = -sat;}
-
-   if(linearSpeed == 0 && yawError[0] == 0) {
-     left = 0;
-     right = 0;
-   }
-  
-    
-    sprintf(moveCmd, "v,%d,%d\n", left, right); //format data for arduino into c string
-    usb.sendData(moveCmd);                      //send movement command to arduino over usb
-    memset(&moveCmd, '\0', sizeof (moveCmd));   //clear the movement command string
+    int length = sprintf(moveCmd, "v,%d,%d\n", left, right); //format data for arduino into c string
+    queueCommand(driveCommand, serial_frame::DRIVE, moveCmd, length); //goes to the arduino with the next write
 }
 
 
@@ -413,50 +234,241 @@ void driveCommandHandler(const geometry_msgs::Twist::ConstPtr& message) {
 // radians, write them to a string and send that to the arduino
 // for processing.
 void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
+  if (binaryProtocol) {
+    float data = angle->data;
+    queueCommand(fingerCommand, serial_frame::FINGER, &data, sizeof (data));
+    return;
+  }
+
   char cmd[16]={'\0'};
+  int length;
 
   // Avoid dealing with negative exponents which confuse the conversion to string by checking if the angle is small
   if (angle->data < 0.01) {
     // 'f' indicates this is a finger command to the arduino
-    sprintf(cmd, "f,0\n");
+    length = sprintf(cmd, "f,0\n");
   } else {
-    sprintf(cmd, "f,%.4g\n", angle->data);
+    length = sprintf(cmd, "f,%.4g\n", angle->data);
   }
-  usb.sendData(cmd);
-  memset(&cmd, '\0', sizeof (cmd));
+  queueCommand(fingerCommand, serial_frame::FINGER, cmd, length);
 }
 
 void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
+  if (binaryProtocol) {
+    float data = angle->data;
+    queueCommand(wristCommand, serial_frame::WRIST, &data, sizeof (data));
+    return;
+  }
+
     char cmd[16]={'\0'};
+    int length;
 
     // Avoid dealing with negative exponents which confuse the conversion to string by checking if the angle is small
   if (angle->data < 0.01) {
     // 'w' indicates this is a wrist command to the arduino
-    sprintf(cmd, "w,0\n");
+    length = sprintf(cmd, "w,0\n");
   } else {
-    sprintf(cmd, "w,%.4g\n", angle->data);
+    length = sprintf(cmd, "w,%.4g\n", angle->data);
   }
-  usb.sendData(cmd);
-  memset(&cmd, '\0', sizeof (cmd));
+  queueCommand(wristCommand, serial_frame::WRIST, cmd, length);
 }
 
 void serialActivityTimer(const ros::TimerEvent& e) {
-    usb.sendData(dataCmd);
-    parseData(usb.readData());
+    //whatever has not answered the last request by now was lost
+    if (requestOutstanding) {
+        for (int i = 0; i < numSensors; i++) {
+            if (!(sensorsUpdated & (1 << i))) samplesMissed[i]++;
+        }
+    }
+    sensorsUpdated = 0;
+    requestOutstanding = true;
+
+    if (binaryProtocol) {
+        queueCommand(dataRequest, serial_frame::DATA_REQUEST, NULL, 0);
+    } else {
+        queueCommand(dataRequest, serial_frame::DATA_REQUEST, dataCmd, strlen(dataCmd));
+    }
+}
+
+//decodes everything complete in the receive buffer; partial lines and
+//frames wait for the rest of their bytes
+void readSerial() {
+    usb.fill();
+    //everything in this read is stamped with when it arrived, not when it gets published
+    ros::Time received = ros::Time::now();
+
+    if (binaryProtocol) {
+        int count;
+        while ((count = usb.readBytes(serialBuffer, sizeof (serialBuffer))) > 0) {
+            int updated = frameDecoder.feed(serialBuffer, count);
+            applyFrames(updated, received);
+            sensorsUpdated |= updated;
+        }
+    } else {
+        string line;
+        while (usb.readLine(line)) sensorsUpdated |= parseData(line, received);
+    }
+
     publishRosTopics();
 }
 
+void queueCommand(PendingCommand& command, uint8_t type, const void* data, int length) {
+    if (length > (int)sizeof (command.data)) return;
+
+    if (command.queued) commandStats.coalesced++;
+    command.queued = true;
+    command.since = ros::Time::now();
+    command.type = type;
+    if (length > 0) memcpy(command.data, data, length);
+    command.length = length;
+}
+
+//sends everything queued since the last pass in a single write, framing it
+//only now so superseded setpoints never take a sequence number
+void flushCommands() {
+    PendingCommand* commands[] = {&driveCommand, &fingerCommand, &wristCommand, &dataRequest};
+    const int numCommands = sizeof (commands) / sizeof (commands[0]);
+    char out[numCommands * serial_frame::MAX_FRAME];
+    int size = 0;
+    ros::Time now = ros::Time::now();
+
+    for (int i = 0; i < numCommands; i++) {
+        PendingCommand& command = *commands[i];
+        if (!command.queued) continue;
+
+        if (binaryProtocol) {
+            size += serial_frame::encode(command.type, frameSequence++, command.data, command.length, (uint8_t*)out + size);
+        } else {
+            memcpy(out + size, command.data, command.length);
+            size += command.length;
+        }
+        command.queued = false;
+
+        //the data request is not a setpoint, so it stays out of the latency
+        if (&command != &dataRequest) {
+            double latency = (now - command.since).toSec();
+            commandStats.commands++;
+            commandStats.latencySum += latency;
+            if (latency > commandStats.latencyMax) commandStats.latencyMax = latency;
+        }
+    }
+
+    if (size == 0) return;
+    commandStats.bytes += usb.sendData(out, size);
+    commandStats.writes++;
+}
+
+//copies what the decoder received into the messages, in the same units as parseData
+void applyFrames(int updated, ros::Time received) {
+    typedef serial_frame::FrameDecoder Decoder;
+
+    if (updated & Decoder::GRIPPER_UPDATED) {
+        fingerAngle.header.stamp = received;
+        fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(frameDecoder.gripper.finger, 0.0, 0.0);
+        wristAngle.header.stamp = received;
+        wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(frameDecoder.gripper.wrist, 0.0, 0.0);
+    }
+    if (updated & Decoder::IMU_UPDATED) {
+        const serial_frame::Imu& data = frameDecoder.imu;
+        imu.header.stamp = received;
+        imu.linear_acceleration.x = data.acceleration[0];
+        imu.linear_acceleration.y = 0; //data.acceleration[1];
+        imu.linear_acceleration.z = data.acceleration[2];
+        imu.angular_velocity.x = data.angularVelocity[0];
+        imu.angular_velocity.y = data.angularVelocity[1];
+        imu.angular_velocity.z = data.angularVelocity[2];
+        imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(data.roll, data.pitch, data.yaw);
+    }
+    if (updated & Decoder::ODOM_UPDATED) {
+        const serial_frame::Odom& data = frameDecoder.odom;
+        odom.header.stamp = received;
+        odom.pose.pose.position.x += data.dx / 100.0;
+        odom.pose.pose.position.y += data.dy / 100.0;
+        odom.pose.pose.position.z = 0.0;
+        odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(data.theta);
+        odom.twist.twist.linear.x = data.vx / 100.0;
+        odom.twist.twist.linear.y = data.vy / 100.0;
+        odom.twist.twist.angular.z = data.angularVelocity;
+    }
+    if (updated & Decoder::SONAR_UPDATED) {
+        const serial_frame::Sonar& data = frameDecoder.sonar;
+        sonarLeft.header.stamp = received;
+        sonarLeft.range = data.left / 100.0;
+        sonarCenter.header.stamp = sonarLeft.header.stamp;
+        sonarCenter.range = data.center / 100.0;
+        sonarRight.header.stamp = sonarLeft.header.stamp;
+        sonarRight.range = data.right / 100.0;
+    }
+}
+
+//running totals of everything that came in wrong, and the outbound rates, once a second
+void serialReportTimer(const ros::TimerEvent& e) {
+    std_msgs::UInt32MultiArray errors;
+    std_msgs::MultiArrayDimension fields;
+    fields.label = "frames,crcErrors,lengthErrors,versionErrors,unknownTypes,droppedBytes,sequenceGaps,malformedLines,"
+            "missedImu,missedOdom,missedSonar,missedGripper,bytesReceived,overflowBytes,overlongLines,readErrors,writeErrors";
+    fields.size = 17;
+    fields.stride = 17;
+    errors.layout.dim.push_back(fields);
+
+    errors.data.push_back(frameDecoder.frames);
+    errors.data.push_back(frameDecoder.crcErrors);
+    errors.data.push_back(frameDecoder.lengthErrors);
+    errors.data.push_back(frameDecoder.versionErrors);
+    errors.data.push_back(frameDecoder.unknownTypes);
+    errors.data.push_back(frameDecoder.droppedBytes);
+    errors.data.push_back(frameDecoder.sequenceGaps);
+    errors.data.push_back(malformedLines);
+    for (int i = 0; i < numSensors; i++) errors.data.push_back(samplesMissed[i]);
+    errors.data.push_back(usb.bytesReceived);
+    errors.data.push_back(usb.overflowBytes);
+    errors.data.push_back(usb.overlongLines);
+    errors.data.push_back(usb.readErrors);
+    errors.data.push_back(usb.writeErrors);
+    serialErrorsPublish.publish(errors);
+
+    std_msgs::Float32MultiArray commands;
+    std_msgs::MultiArrayDimension commandFields;
+    commandFields.label = "bytesPerSecond,writesPerSecond,coalescedPerSecond,meanLatencyMs,maxLatencyMs";
+    commandFields.size = 5;
+    commandFields.stride = 5;
+    commands.layout.dim.push_back(commandFields);
+
+    double seconds = e.last_real.isZero() ? 1.0 : (e.current_real - e.last_real).toSec();
+    if (seconds <= 0) seconds = 1.0;
+    commands.data.push_back(commandStats.bytes / seconds);
+    commands.data.push_back(commandStats.writes / seconds);
+    commands.data.push_back(commandStats.coalesced / seconds);
+    commands.data.push_back(commandStats.commands > 0 ? 1000 * commandStats.latencySum / commandStats.commands : 0);
+    commands.data.push_back(1000 * commandStats.latencyMax);
+    serialCommandsPublish.publish(commands);
+
+    memset(&commandStats, 0, sizeof (commandStats));
+}
+
+//publishes message unless it is the same sample as the last one published
+template <typename Message>
+void publishIfNew(ros::Publisher& publisher, const Message& message, ros::Time& published) {
+    if (message.header.stamp == published) return;
+    publisher.publish(message);
+    published = message.header.stamp;
+}
+
+//sends only the topics that have received a sample since they were last sent
 void publishRosTopics() {
-    fingerAnglePublish.publish(fingerAngle);
-    wristAnglePublish.publish(wristAngle);
-    imuPublish.publish(imu);
-    odomPublish.publish(odom);
-    sonarLeftPublish.publish(sonarLeft);
-    sonarCenterPublish.publish(sonarCenter);
-    sonarRightPublish.publish(sonarRight);
+    publishIfNew(fingerAnglePublish, fingerAngle, fingerAnglePublished);
+    publishIfNew(wristAnglePublish, wristAngle, wristAnglePublished);
+    publishIfNew(imuPublish, imu, imuPublished);
+    publishIfNew(odomPublish, odom, odomPublished);
+    publishIfNew(sonarLeftPublish, sonarLeft, sonarLeftPublished);
+    publishIfNew(sonarCenterPublish, sonarCenter, sonarCenterPublished);
+    publishIfNew(sonarRightPublish, sonarRight, sonarRightPublished);
 }
 
-void parseData(string str) {
+//returns the FrameDecoder bits for the sensors it updated
+int parseData(string str, ros::Time received) {
+    typedef serial_frame::FrameDecoder Decoder;
+    int updated = 0;
     istringstream oss(str);
     string sentence;
     
@@ -469,18 +481,31 @@ void parseData(string str) {
 			dataSet.push_back(word);
 		}
 
-		if (dataSet.size() >= 3 && dataSet.at(1) == "1") {
+		//fields each sentence needs
+		size_t needed = 3;
+		if (!dataSet.empty() && dataSet.at(0) == "IMU") needed = 11;
+		else if (!dataSet.empty() && dataSet.at(0) == "ODOM") needed = 8;
+
+		if (dataSet.size() < needed) {
+			malformedLines++;
+			continue;
+		}
+
+		if (dataSet.at(1) == "1") {
 
 			if (dataSet.at(0) == "GRF") {
-				fingerAngle.header.stamp = ros::Time::now();
+				updated |= Decoder::GRIPPER_UPDATED;
+				fingerAngle.header.stamp = received;
 				fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(2).c_str()), 0.0, 0.0);
 			}
 			else if (dataSet.at(0) == "GRW") {
-				wristAngle.header.stamp = ros::Time::now();
+				updated |= Decoder::GRIPPER_UPDATED;
+				wristAngle.header.stamp = received;
 				wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(2).c_str()), 0.0, 0.0);
 			}
 			else if (dataSet.at(0) == "IMU") {
-				imu.header.stamp = ros::Time::now();
+				updated |= Decoder::IMU_UPDATED;
+				imu.header.stamp = received;
 				imu.linear_acceleration.x = atof(dataSet.at(2).c_str());
 				imu.linear_acceleration.y = 0; //atof(dataSet.at(3).c_str());
 				imu.linear_acceleration.z = atof(dataSet.at(4).c_str());
@@ -490,7 +515,8 @@ void parseData(string str) {
 				imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(8).c_str()), atof(dataSet.at(9).c_str()), atof(dataSet.at(10).c_str()));
 			}
 			else if (dataSet.at(0) == "ODOM") {
-				odom.header.stamp = ros::Time::now();
+				updated |= Decoder::ODOM_UPDATED;
+				odom.header.stamp = received;
 				odom.pose.pose.position.x += atof(dataSet.at(2).c_str()) / 100.0;
 				odom.pose.pose.position.y += atof(dataSet.at(3).c_str()) / 100.0;
 				odom.pose.pose.position.z = 0.0;
@@ -500,20 +526,28 @@ void parseData(string str) {
 				odom.twist.twist.angular.z = atof(dataSet.at(7).c_str());
 			}
 			else if (dataSet.at(0) == "USL") {
-				sonarLeft.header.stamp = ros::Time::now();
+				updated |= Decoder::SONAR_UPDATED;
+				sonarLeft.header.stamp = received;
 				sonarLeft.range = atof(dataSet.at(2).c_str()) / 100.0;
 			}
 			else if (dataSet.at(0) == "USC") {
-				sonarCenter.header.stamp = ros::Time::now();
+				updated |= Decoder::SONAR_UPDATED;
+				sonarCenter.header.stamp = received;
 				sonarCenter.range = atof(dataSet.at(2).c_str()) / 100.0;
 			}
 			else if (dataSet.at(0) == "USR") {
-				sonarRight.header.stamp = ros::Time::now();
+				updated |= Decoder::SONAR_UPDATED;
+				sonarRight.header.stamp = received;
 				sonarRight.range = atof(dataSet.at(2).c_str()) / 100.0;
 			}
+			else {
+				malformedLines++;
+			}
 
 		}
 	}
+
+	return updated;
 }
 
 
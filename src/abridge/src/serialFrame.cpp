@@ -0,0 +1,153 @@
+#include "serialFrame.h"
+#include <string.h>
+
+namespace serial_frame {
+
+uint16_t crc16(const uint8_t* data, int length) {
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+int encode(uint8_t type, uint8_t sequence, const void* payload, int length, uint8_t* out) {
+    if (length < 0 || length > MAX_PAYLOAD) return 0;
+
+    out[0] = SYNC1;
+    out[1] = SYNC2;
+    out[2] = VERSION;
+    out[3] = type;
+    out[4] = length;
+    out[5] = sequence;
+    if (length > 0) memcpy(out + HEADER_SIZE, payload, length);
+
+    uint16_t crc = crc16(out + 2, HEADER_SIZE - 2 + length);
+    out[HEADER_SIZE + length] = crc & 0xFF;
+    out[HEADER_SIZE + length + 1] = crc >> 8;
+    return HEADER_SIZE + length + CRC_SIZE;
+}
+
+FrameDecoder::FrameDecoder() {
+    memset(&imu, 0, sizeof (imu));
+    memset(&odom, 0, sizeof (odom));
+    memset(&sonar, 0, sizeof (sonar));
+    memset(&gripper, 0, sizeof (gripper));
+
+    frames = 0;
+    crcErrors = 0;
+    lengthErrors = 0;
+    versionErrors = 0;
+    unknownTypes = 0;
+    droppedBytes = 0;
+    sequenceGaps = 0;
+
+    received = 0;
+    expected = 0;
+    lastSequence = -1;
+}
+
+int FrameDecoder::feed(const uint8_t* data, int length) {
+    int updated = 0;
+
+    for (int i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        // hunting for the sync pair
+        if (received == 0) {
+            if (byte == SYNC1) frame[received++] = byte;
+            else droppedBytes++;
+            continue;
+        }
+        if (received == 1) {
+            if (byte == SYNC2) {
+                frame[received++] = byte;
+            } else if (byte != SYNC1) {
+                droppedBytes += 2;
+                received = 0;
+            } else {
+                droppedBytes++; // a repeated first sync byte starts over
+            }
+            continue;
+        }
+
+        frame[received++] = byte;
+
+        if (received == 3 && byte != VERSION) {
+            versionErrors++;
+            updated |= rescan();
+            continue;
+        }
+        if (received == 5) {
+            if (byte > MAX_PAYLOAD) {
+                lengthErrors++;
+                updated |= rescan();
+                continue;
+            }
+            expected = HEADER_SIZE + byte + CRC_SIZE;
+        }
+
+        if (received >= HEADER_SIZE && received == expected) {
+            int payloadLength = frame[4];
+            uint16_t crc = frame[HEADER_SIZE + payloadLength] | (frame[HEADER_SIZE + payloadLength + 1] << 8);
+            if (crc != crc16(frame + 2, HEADER_SIZE - 2 + payloadLength)) {
+                crcErrors++;
+                updated |= rescan();
+            } else {
+                updated |= deliver();
+                received = 0;
+            }
+        }
+    }
+
+    return updated;
+}
+
+// the frame in frame[] is bad, but a corrupted length can have swallowed the
+// start of the next one, so everything after its first sync byte is searched
+// again; one bad byte costs at most the frame it landed in
+int FrameDecoder::rescan() {
+    uint8_t rest[MAX_FRAME];
+    int count = received - 1;
+    memcpy(rest, frame + 1, count);
+    received = 0;
+    droppedBytes++;
+    return feed(rest, count);
+}
+
+// the frame in frame[] passed its CRC
+int FrameDecoder::deliver() {
+    uint8_t type = frame[3];
+    int length = frame[4];
+    int sequence = frame[5];
+    const uint8_t* payload = frame + HEADER_SIZE;
+
+    frames++;
+    if (lastSequence >= 0) sequenceGaps += (sequence - lastSequence - 1) & 0xFF;
+    lastSequence = sequence;
+
+    void* target;
+    int size;
+    int bit;
+    switch (type) {
+    case IMU: target = &imu; size = sizeof (imu); bit = IMU_UPDATED; break;
+    case ODOM: target = &odom; size = sizeof (odom); bit = ODOM_UPDATED; break;
+    case SONAR: target = &sonar; size = sizeof (sonar); bit = SONAR_UPDATED; break;
+    case GRIPPER: target = &gripper; size = sizeof (gripper); bit = GRIPPER_UPDATED; break;
+    default:
+        unknownTypes++;
+        return 0;
+    }
+
+    if (length != size) {
+        lengthErrors++;
+        return 0;
+    }
+    memcpy(target, payload, size);
+    return bit;
+}
+
+}
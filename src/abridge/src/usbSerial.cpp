@@ -1,9 +1,16 @@
 #include "usbSerial.h"
+#include <errno.h>
 
 using namespace std;
 
 USBSerial::USBSerial() {
-
+    head = 0;
+    tail = 0;
+    bytesReceived = 0;
+    overflowBytes = 0;
+    overlongLines = 0;
+    readErrors = 0;
+    writeErrors = 0;
 }
 
 void USBSerial::openUSBPort(string devicePath, int baud) {
@@ -23,22 +30,114 @@ void USBSerial::openUSBPort(string devicePath, int baud) {
     cfsetospeed(&ioStruct, B115200);
     cfsetispeed(&ioStruct, B115200);
     tcsetattr(usbFileDescriptor, TCSANOW, &ioStruct);
+    //only stale input from before we opened is thrown away; after this every byte is kept
+    tcflush(usbFileDescriptor, TCIOFLUSH);
 }
 
-void USBSerial::sendData(char data[]) {
-    sprintf(dataOut, "%s", data);
-    write(usbFileDescriptor, dataOut, sizeof (dataOut));
-    memset(&dataOut, '\0', sizeof (dataOut));
+int USBSerial::sendData(const char* data, int length) {
+    int sent = 0;
+    while (sent < length) {
+        int count = write(usbFileDescriptor, data + sent, length - sent);
+        if (count > 0) {
+            sent += count;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            //the port is non-blocking; wait for room rather than drop the rest
+            struct pollfd port;
+            port.fd = usbFileDescriptor;
+            port.events = POLLOUT;
+            port.revents = 0;
+            if (poll(&port, 1, 100) <= 0) {
+                writeErrors++;
+                break;
+            }
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            writeErrors++;
+            break;
+        }
+    }
+    return sent;
 }
 
 string USBSerial::readData() {
-    if (read(usbFileDescriptor, &serialDataIn, sizeof (serialDataIn)) > 0) {
-        read(usbFileDescriptor, &serialDataIn, sizeof (serialDataIn));
+    fill();
+    string data;
+    string line;
+    while (readLine(line)) {
+        data += line;
+        data += '\n';
+    }
+    return data;
+}
+
+int USBSerial::readBytes(uint8_t* buffer, int size) {
+    fill();
+    int count = 0;
+    while (count < size && tail != head) {
+        buffer[count++] = ring[tail];
+        tail = (tail + 1) % bufferSize;
+    }
+    return count;
+}
+
+bool USBSerial::waitForData(int timeout) {
+    struct pollfd port;
+    port.fd = usbFileDescriptor;
+    port.events = POLLIN;
+    port.revents = 0;
+    return poll(&port, 1, timeout) > 0 && (port.revents & POLLIN);
+}
+
+int USBSerial::fill() {
+    uint8_t chunk[256];
+    int total = 0;
+
+    while (true) {
+        int count = read(usbFileDescriptor, chunk, sizeof (chunk));
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) readErrors++;
+        if (count <= 0) break;
+
+        for (int i = 0; i < count; i++) {
+            ring[head] = chunk[i];
+            head = (head + 1) % bufferSize;
+            if (head == tail) {
+                //full, so the oldest byte goes
+                tail = (tail + 1) % bufferSize;
+                overflowBytes++;
+            }
+        }
+        total += count;
+    }
+
+    bytesReceived += total;
+    return total;
+}
+
+bool USBSerial::readLine(string& line) {
+    while (true) {
+        int end = tail;
+        while (end != head && ring[end] != '\n') end = (end + 1) % bufferSize;
+        if (end == head) {
+            //no newline yet; a partial line that can never fit is dropped
+            if (buffered() >= maxLine) {
+                tail = head;
+                overlongLines++;
+            }
+            return false;
+        }
+
+        int length = (end - tail + bufferSize) % bufferSize;
+        bool fits = length <= maxLine;
+        if (fits) {
+            line.clear();
+            for (int i = tail; i != end; i = (i + 1) % bufferSize) line += (char)ring[i];
+        } else {
+            overlongLines++;
+        }
+        tail = (end + 1) % bufferSize;
+        if (fits) return true;
     }
-    string str(serialDataIn);
-    tcflush(usbFileDescriptor, TCIOFLUSH);
-    memset(&serialDataIn, '\0', sizeof (serialDataIn));
-    return str;
 }
 
 void USBSerial::closeUSBPort() {
@@ -2,7 +2,7 @@
 #define GRIPPER_MANAGER_H
 
 #include <ros/console.h>
-#include "PIDController.h"
+#include <pid_controller/PIDController.h>
 
 /**
  * This class defines the interface between the GripperPlugin class and the PID
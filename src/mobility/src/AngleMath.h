@@ -0,0 +1,56 @@
+#ifndef ANGLE_MATH_H
+#define ANGLE_MATH_H
+
+#include <cmath>
+
+/**
+ * Angle helpers for the controllers. Wrapping is done with one floor() instead
+ * of loops that add or subtract 2pi, so it costs the same for any input: a
+ * heading of 1e9 from corrupted odometry takes as long as a heading of 1, and
+ * a NaN comes straight back out instead of spinning forever.
+ *
+ * The batched versions run the same kernel over arrays with no branches in
+ * the loop body, so the compiler is free to vectorize them.
+ */
+namespace angle_math {
+
+const double twoPi = 2 * M_PI;
+
+// to [-pi, pi)
+inline double wrap(double angle) {
+  return angle - twoPi * floor((angle + M_PI) / twoPi);
+}
+
+// to [0, 2pi)
+inline double wrapPositive(double angle) {
+  return angle - twoPi * floor(angle / twoPi);
+}
+
+// signed turn, at most half a circle, that takes from onto to
+inline double difference(double to, double from) {
+  return wrap(to - from);
+}
+
+inline void wrap(double* angles, int count) {
+  for (int i = 0; i < count; i++) angles[i] = wrap(angles[i]);
+}
+
+inline void difference(const double* to, const double* from, double* result, int count) {
+  for (int i = 0; i < count; i++) result[i] = wrap(to[i] - from[i]);
+}
+
+// mean direction on the unit circle, so 179 and -179 degrees average to 180
+// rather than 0. Returns 0 for an empty set.
+inline double circularMean(const double* angles, int count) {
+  double sumSin = 0;
+  double sumCos = 0;
+  for (int i = 0; i < count; i++) {
+    sumSin += sin(angles[i]);
+    sumCos += cos(angles[i]);
+  }
+  return atan2(sumSin, sumCos);
+}
+
+} // namespace angle_math
+
+#endif /* ANGLE_MATH_H */
@@ -0,0 +1,44 @@
+#include "ArenaFrame.h"
+#include <cmath>
+
+ArenaFrame::ArenaFrame() {
+  cosRotation = 1;
+  sinRotation = 0;
+  nestX = 0;
+  nestY = 0;
+  nestSigma = 0;
+  headingSigma = 0.1;
+  haveHeading = false;
+  haveNest = false;
+}
+
+void ArenaFrame::update(const geometry_msgs::Pose2D& odomPose, const geometry_msgs::Pose2D& mapPose) {
+  double rotation = mapPose.theta - odomPose.theta;
+  cosRotation = cos(rotation);
+  sinRotation = sin(rotation);
+  haveHeading = true;
+}
+
+void ArenaFrame::setNest(float x, float y, float sigma) {
+  nestX = x;
+  nestY = y;
+  nestSigma = sigma;
+  haveNest = true;
+}
+
+double ArenaFrame::getError(double arenaX, double arenaY) {
+  double swing = hypot(arenaX, arenaY) * headingSigma;
+  return sqrt(nestSigma * nestSigma + swing * swing);
+}
+
+void ArenaFrame::toArena(double odomX, double odomY, double& arenaX, double& arenaY) {
+  double dx = odomX - nestX;
+  double dy = odomY - nestY;
+  arenaX = cosRotation * dx - sinRotation * dy;
+  arenaY = sinRotation * dx + cosRotation * dy;
+}
+
+void ArenaFrame::toOdom(double arenaX, double arenaY, double& odomX, double& odomY) {
+  odomX = nestX + cosRotation * arenaX + sinRotation * arenaY;
+  odomY = nestY - sinRotation * arenaX + cosRotation * arenaY;
+}
@@ -0,0 +1,58 @@
+#ifndef ARENA_FRAME_H
+#define ARENA_FRAME_H
+
+#include <geometry_msgs/Pose2D.h>
+
+/**
+ * Every rover's odometry frame starts wherever and however that rover was
+ * placed, so odom coordinates can not be shared between rovers. The arena frame
+ * is the one they can share: centered on the collection zone with its axes
+ * pointing east and north.
+ *
+ * The map (GPS/IMU) pose gives the heading offset between odom and east-north,
+ * and the nest position in odom gives the origin. GPS position noise does not
+ * enter the conversion, only the map heading does.
+ *
+ * The origin is only as good as this rover's estimate of the nest, and the
+ * axes only as good as its heading, so two rovers' frames disagree by the
+ * nest error plus the heading error swung out over the distance from the
+ * nest. getError() gives that, for sizing how close two rovers' positions
+ * must be to mean the same place.
+ */
+class ArenaFrame {
+
+  public:
+
+    ArenaFrame();
+
+    // feed the odom and map poses from the same tick
+    void update(const geometry_msgs::Pose2D& odomPose, const geometry_msgs::Pose2D& mapPose);
+
+    // collection zone position in odom coordinates, and its standard deviation
+    void setNest(float x, float y, float sigma);
+
+    // standard deviation of the map heading, radians
+    void setHeadingSigma(double sigma) {headingSigma = sigma;}
+
+    // standard deviation in meters of an arena position as this rover places it
+    double getError(double arenaX, double arenaY);
+
+    // false until both the heading offset and the nest are known
+    bool isValid() {return haveHeading && haveNest;}
+
+    void toArena(double odomX, double odomY, double& arenaX, double& arenaY);
+    void toOdom(double arenaX, double arenaY, double& odomX, double& odomY);
+
+  private:
+
+    double cosRotation;
+    double sinRotation;
+    double nestX;
+    double nestY;
+    double nestSigma;
+    double headingSigma;
+    bool haveHeading;
+    bool haveNest;
+};
+
+#endif /* ARENA_FRAME_H */
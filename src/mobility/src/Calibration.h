@@ -2,6 +2,7 @@
 #define CALIBRATION_H
 #include <ros/ros.h>
 #include <geometry_msgs/Pose2D.h>
+#include "Stopwatch.h"
 
 
 class Calibration {
@@ -27,7 +28,7 @@ float pickupSpeed;//meters per second
 
 const static float backupTime = 4.0;//seconds
 
-ros::Time omniTimerStartingTime;
+Stopwatch omniTimer;
 
 
 };
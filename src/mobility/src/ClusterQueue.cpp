@@ -0,0 +1,95 @@
+#include "ClusterQueue.h"
+#include <cmath>
+
+ClusterQueue::ClusterQueue(unsigned int capacity, float mergeRadius, float maxAge) {
+  this->capacity = capacity > 0 ? capacity : 1;
+  this->mergeRadius = mergeRadius;
+  this->maxAge = maxAge;
+  clusters.reserve(this->capacity);
+}
+
+int ClusterQueue::find(float x, float y) {
+  for (unsigned int i = 0; i < clusters.size(); i++) {
+    if (hypot(clusters[i].x - x, clusters[i].y - y) < mergeRadius) return i;
+  }
+  return -1;
+}
+
+void ClusterQueue::dropStale() {
+  ros::Time now = ros::Time::now();
+  for (unsigned int i = 0; i < clusters.size(); ) {
+    if ((now - clusters[i].lastSeen).toSec() > maxAge) {
+      clusters[i] = clusters.back();
+      clusters.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+void ClusterQueue::report(float x, float y, int cubes) {
+  if (cubes <= 0) return;
+  dropStale();
+
+  Cluster cluster;
+  cluster.x = x;
+  cluster.y = y;
+  cluster.cubes = cubes;
+  cluster.lastSeen = ros::Time::now();
+
+  // the newest count is the best estimate of what is left; average positions
+  int i = find(x, y);
+  if (i >= 0) {
+    cluster.x = (clusters[i].x + x) / 2;
+    cluster.y = (clusters[i].y + y) / 2;
+    clusters[i] = cluster;
+    return;
+  }
+
+  if (clusters.size() < capacity) {
+    clusters.push_back(cluster);
+    return;
+  }
+
+  // full: replace the smallest cluster if this one is bigger
+  unsigned int smallest = 0;
+  for (unsigned int j = 1; j < clusters.size(); j++) {
+    if (clusters[j].cubes < clusters[smallest].cubes) smallest = j;
+  }
+  if (clusters[smallest].cubes < cubes) clusters[smallest] = cluster;
+}
+
+void ClusterQueue::cubeTaken(float x, float y) {
+  int i = find(x, y);
+  if (i < 0) return;
+
+  clusters[i].cubes--;
+  if (clusters[i].cubes <= 0) {
+    clusters[i] = clusters.back();
+    clusters.pop_back();
+  }
+}
+
+float ClusterQueue::priority(const Cluster& cluster, const geometry_msgs::Pose2D& from) {
+  return cluster.cubes / (1 + hypot(cluster.x - from.x, cluster.y - from.y));
+}
+
+bool ClusterQueue::pop(const geometry_msgs::Pose2D& from, Cluster& best) {
+  dropStale();
+  if (clusters.empty()) return false;
+
+  unsigned int bestIndex = 0;
+  float bestPriority = priority(clusters[0], from);
+  for (unsigned int i = 1; i < clusters.size(); i++) {
+    float p = priority(clusters[i], from);
+    if (p > bestPriority) {
+      bestPriority = p;
+      bestIndex = i;
+    }
+  }
+
+  best = clusters[bestIndex];
+  clusters[bestIndex] = clusters.back();
+  clusters.pop_back();
+  return true;
+}
@@ -0,0 +1,56 @@
+#ifndef CLUSTER_QUEUE_H
+#define CLUSTER_QUEUE_H
+
+#include <vector>
+#include <ros/ros.h>
+#include <geometry_msgs/Pose2D.h>
+
+/**
+ * Remembers the clusters of cubes a rover has driven past so it can go back to
+ * them later. Each entry holds an estimate of the cubes still there; the best
+ * entry is the one with the most cubes per meter of travel from where the rover
+ * is when it asks. Sightings close to an existing entry update that entry.
+ *
+ * The queue is small and bounded: when it is full a new sighting replaces the
+ * worst entry, if it is better. Because the ranking depends on the rover's
+ * position at the time of asking, pop() scans the entries rather than keeping
+ * a heap.
+ */
+class ClusterQueue {
+
+  public:
+
+    struct Cluster {
+      float x;
+      float y;
+      int cubes;          // estimated cubes left
+      ros::Time lastSeen;
+    };
+
+    ClusterQueue(unsigned int capacity, float mergeRadius, float maxAge);
+
+    void report(float x, float y, int cubes);
+
+    // one cube was taken at (x, y); forget the cluster once it is used up
+    void cubeTaken(float x, float y);
+
+    // removes the best cluster for a rover at from, false if there are none
+    bool pop(const geometry_msgs::Pose2D& from, Cluster& best);
+
+    bool empty() {return clusters.empty();}
+    unsigned int size() {return clusters.size();}
+    void clear() {clusters.clear();}
+
+  private:
+
+    float priority(const Cluster& cluster, const geometry_msgs::Pose2D& from);
+    int find(float x, float y);
+    void dropStale();
+
+    std::vector<Cluster> clusters;
+    unsigned int capacity;
+    float mergeRadius;
+    float maxAge;
+};
+
+#endif /* CLUSTER_QUEUE_H */
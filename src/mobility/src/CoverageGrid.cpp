@@ -0,0 +1,125 @@
+#include "CoverageGrid.h"
+#include <cmath>
+
+CoverageGrid::CoverageGrid(ArenaFrame& frame, double halfWidth, double cellSize) : frame(frame) {
+  if (cellSize <= 0) cellSize = 0.5;
+  cellsPerSide = (int)ceil(2 * halfWidth / cellSize);
+
+  // cell numbers have to fit the 16 bit message words
+  if (cellsPerSide > 255) cellsPerSide = 255;
+  if (cellsPerSide < 1) cellsPerSide = 1;
+
+  this->cellSize = cellSize;
+  this->halfWidth = cellsPerSide * cellSize / 2;
+  cellCount = cellsPerSide * cellsPerSide;
+  visitedCount = 0;
+
+  visited.assign((cellCount + 31) / 32, 0);
+  pending.assign((cellCount + 31) / 32, 0);
+}
+
+int CoverageGrid::cellAt(double arenaX, double arenaY) {
+  int column = (int)floor((arenaX + halfWidth) / cellSize);
+  int row = (int)floor((arenaY + halfWidth) / cellSize);
+  if (column < 0 || column >= cellsPerSide || row < 0 || row >= cellsPerSide) return -1;
+  return row * cellsPerSide + column;
+}
+
+void CoverageGrid::markVisited(const geometry_msgs::Pose2D& odomPose, double radius) {
+  if (!frame.isValid()) return;
+
+  double x, y;
+  frame.toArena(odomPose.x, odomPose.y, x, y);
+
+  int reach = (int)ceil(radius / cellSize);
+  for (int dy = -reach; dy <= reach; dy++) {
+    for (int dx = -reach; dx <= reach; dx++) {
+      if ((dx*dx + dy*dy) * cellSize * cellSize > radius * radius) continue;
+
+      int cell = cellAt(x + dx * cellSize, y + dy * cellSize);
+      if (cell < 0 || testBit(visited, cell)) continue;
+
+      setBit(visited, cell);
+      setBit(pending, cell);
+      visitedCount++;
+    }
+  }
+}
+
+bool CoverageGrid::isVisited(double odomX, double odomY) {
+  if (!frame.isValid()) return false;
+
+  double x, y;
+  frame.toArena(odomX, odomY, x, y);
+  int cell = cellAt(x, y);
+  return cell < 0 || testBit(visited, cell);
+}
+
+void CoverageGrid::encodeRuns(const std::vector<uint32_t>& bits, std_msgs::UInt16MultiArray& message) {
+  message.data.clear();
+  message.data.push_back(cellsPerSide);
+  message.data.push_back((uint16_t)(cellSize * 1000 + 0.5));
+
+  int runStart = -1;
+  for (int cell = 0; cell < cellCount; cell++) {
+    // skip empty words in one go
+    if (runStart < 0 && (cell & 31) == 0 && bits[cell >> 5] == 0) {
+      cell += 31;
+      continue;
+    }
+
+    bool set = testBit(bits, cell);
+    if (set && runStart < 0) {
+      runStart = cell;
+    } else if (!set && runStart >= 0) {
+      message.data.push_back(runStart);
+      message.data.push_back(cell - runStart);
+      runStart = -1;
+    }
+  }
+  if (runStart >= 0) {
+    message.data.push_back(runStart);
+    message.data.push_back(cellCount - runStart);
+  }
+}
+
+bool CoverageGrid::takeDelta(std_msgs::UInt16MultiArray& message) {
+  bool any = false;
+  for (unsigned int i = 0; i < pending.size(); i++) {
+    if (pending[i]) {
+      any = true;
+      break;
+    }
+  }
+  if (!any) return false;
+
+  encodeRuns(pending, message);
+  pending.assign(pending.size(), 0);
+  return true;
+}
+
+void CoverageGrid::getSnapshot(std_msgs::UInt16MultiArray& message) {
+  encodeRuns(visited, message);
+}
+
+void CoverageGrid::merge(const std_msgs::UInt16MultiArray& message) {
+  // ignore grids laid out differently from ours
+  if (message.data.size() < 2) return;
+  if (message.data[0] != cellsPerSide || message.data[1] != (uint16_t)(cellSize * 1000 + 0.5)) return;
+
+  for (unsigned int i = 2; i + 1 < message.data.size(); i += 2) {
+    int start = message.data[i];
+    int end = start + message.data[i + 1];
+    if (end > cellCount) end = cellCount;
+
+    for (int cell = start; cell < end; cell++) {
+      if (testBit(visited, cell)) continue;
+      setBit(visited, cell);
+      visitedCount++;
+    }
+  }
+}
+
+float CoverageGrid::getCoveredFraction() {
+  return (float)visitedCount / cellCount;
+}
@@ -0,0 +1,62 @@
+#ifndef COVERAGE_GRID_H
+#define COVERAGE_GRID_H
+
+#include <vector>
+#include <stdint.h>
+#include <geometry_msgs/Pose2D.h>
+#include <std_msgs/UInt16MultiArray.h>
+#include "ArenaFrame.h"
+
+/**
+ * One bit per cell record of where the swarm has already been. The grid lives
+ * in the shared arena frame so rovers can merge each other's grids; callers
+ * use their own odom coordinates and the ArenaFrame does the conversion.
+ *
+ * Rovers exchange deltas: the cells that became visited since the last
+ * exchange, as run-length encoded (first cell, run length) pairs after a two
+ * word header (cells per side, cell size in millimeters). A full snapshot uses
+ * the same format so it can repair deltas a teammate missed.
+ */
+class CoverageGrid {
+
+  public:
+
+    CoverageGrid(ArenaFrame& frame, double halfWidth, double cellSize);
+
+    // marks every cell within radius meters of the pose
+    void markVisited(const geometry_msgs::Pose2D& odomPose, double radius);
+
+    // points outside the grid count as visited so nobody is sent there
+    bool isVisited(double odomX, double odomY);
+
+    // fills message with the cells this rover visited since the last call,
+    // returns false (and leaves message alone) if there were none
+    bool takeDelta(std_msgs::UInt16MultiArray& message);
+    void getSnapshot(std_msgs::UInt16MultiArray& message);
+
+    // ORs a teammate's delta or snapshot into the grid
+    void merge(const std_msgs::UInt16MultiArray& message);
+
+    float getCoveredFraction();
+
+  private:
+
+    bool testBit(const std::vector<uint32_t>& bits, int cell) {return (bits[cell >> 5] >> (cell & 31)) & 1;}
+    void setBit(std::vector<uint32_t>& bits, int cell) {bits[cell >> 5] |= (uint32_t)1 << (cell & 31);}
+
+    // -1 if the point is off the grid
+    int cellAt(double arenaX, double arenaY);
+    void encodeRuns(const std::vector<uint32_t>& bits, std_msgs::UInt16MultiArray& message);
+
+    ArenaFrame& frame;
+    double halfWidth;
+    double cellSize;
+    int cellsPerSide;
+    int cellCount;
+    int visitedCount;
+
+    std::vector<uint32_t> visited;
+    std::vector<uint32_t> pending; // visited by us, not yet sent
+};
+
+#endif /* COVERAGE_GRID_H */
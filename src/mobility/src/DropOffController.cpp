@@ -19,6 +19,9 @@ overall goals:
 
 DropOffController::DropOffController() {
 	countLeft = 0; countRight = 0;
+	telemetry = NULL;
+	telemetryId = 0;
+	sequenceActive = false;
 	//test lol
 }
 
@@ -26,8 +29,7 @@ void DropOffController::setTagCountToZeroIfAppropriate()
 {
 //if it has been duration seconds, then it means the openCV has not given us new base tag info for 3 seconds so it probably hasn't seen the base for 3 seconds.
 float duration = 3.0;
-ros::Duration timeDifferenceObject = ros::Time::now() - lastTimeISawTheCenterBase;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!sinceISawTheCenterBase.hasElapsed(duration))
 {
 return;//hasnt been duration seconds yet
 }
@@ -42,11 +44,33 @@ return;
 }//end void setTagCountToZeroIfAppropriate
 
 void DropOffController::reset() {
+//the drop off ends in whatever phase it got to
+if (sequenceActive && telemetry != NULL)
+	telemetry->record(telemetryId, state, -1, phaseTimer.elapsed(), state != DONE_DROPPING_OFF);
+sequenceActive = false;
+
 setState(DropOffController::FINDING_BASE);
 numTimesPausedAndTurned = 0;
 
 }
 
+void DropOffController::beginDropOff()
+{
+phaseTimer.restart();
+sequenceActive = true;
+}
+
+void DropOffController::setState(int stateSet, bool failed)
+{
+if (stateSet != state)
+{
+	if (sequenceActive && telemetry != NULL)
+		telemetry->record(telemetryId, state, stateSet, phaseTimer.elapsed(), failed);
+	phaseTimer.restart();
+}
+state = stateSet;
+}
+
 //setDataTargets is called on its own "thread" by the targetSubscriber (/bravo/targets) topic. only called VERBATIM IN MOBILITY.CPP if (message->detections.size() > 0 && !reachedCollectionPoint[note this is a completely different variable with the same name that lives in mobility.cpp]) 
 //@param: ccount=total number of goalspots, @lleft = number of goalspots on left half of camera, @rright = number of goalspots on right half of camera
 void DropOffController::setDataTargets(int lleft, int rright)
@@ -54,7 +78,7 @@ void DropOffController::setDataTargets(int lleft, int rright)
    countLeft = lleft;
    countRight = rright;
 	//so i can set it to back to 0-targets-seen if it exceeds the threshold time (because i cant "poll" the sensors)
-	lastTimeISawTheCenterBase = ros::Time::now();
+	sinceISawTheCenterBase.restart();
 }
 
 DropOffController::~DropOffController() {
@@ -5,6 +5,8 @@
 #include <geometry_msgs/Pose2D.h>
 #include <std_msgs/Float32.h>
 #include <ros/ros.h>
+#include "Stopwatch.h"
+#include "PhaseTelemetry.h"
 
 
 class DropOffController
@@ -16,17 +18,22 @@ public:
 int state;
 const static int FINDING_BASE = 0, ADJUSTING_ANGLE_FOR_ENTRY = 1, ENTERING_BASE = 2, DROPPING_CUBE = 3, BACKING_OUT_OF_BASE = 4, DONE_DROPPING_OFF = 5,
 	 PAUSING_BEFORE_ROTATING_AGAIN = 6, SCOOTING_CLOSER_TO_BASE = 7;
+const static int NUM_STATES = 8;
     
     void setDataTargets(int numLeft, int numRight);
 int getState(){return state;}
-	void setState(int stateSet){state = stateSet;}
+	void setState(int stateSet, bool failed = false);
 void reset();
+//starts timing the phases of a drop off, until reset()
+void beginDropOff();
+//every phase change from here on is also recorded as controller id
+void setTelemetry(PhaseTelemetry* telemetry, int id) {this->telemetry = telemetry; telemetryId = id;}
 void setTagCountToZeroIfAppropriate();
 int getCountLeft(){return countLeft;}
 int getCountRight(){return countRight;}
 
-ros::Time omniTimerStartingTime;
-ros::Time lastTimeISawTheCenterBase;
+Stopwatch omniTimer;
+Stopwatch sinceISawTheCenterBase;
 
 std::string getStateName() {
 const std::string stateNames[] = {"FINDING_BASE","ADJUSTING_ANGLE_FOR_ENTRY","ENTERING_BASE","DROPPING_CUBE","BACKING_OUT_OF_BASE","DONE_DROPPING_OFF"
@@ -48,5 +55,9 @@ const static int giveUpAndDropAfterTurningThisManyTimes = 8;
 private:
     int countLeft;
     int countRight;
+    Stopwatch phaseTimer;
+    PhaseTelemetry* telemetry;
+    int telemetryId;
+    bool sequenceActive;
 };
 #endif // end header define
@@ -0,0 +1,136 @@
+#include "LoopTrigger.h"
+#include "Stopwatch.h"
+#include <boost/make_shared.hpp>
+
+// what goes into the callback queue for a triggered run
+class LoopTrigger::Run : public ros::CallbackInterface {
+
+  public:
+
+    Run(LoopTrigger* owner, Source source, const ros::Time& stamp) : owner(owner), source(source), stamp(stamp) {}
+
+    CallResult call() {
+      owner->run(source, stamp);
+      return Success;
+    }
+
+  private:
+
+    LoopTrigger* owner;
+    Source source;
+    ros::Time stamp;
+};
+
+LoopTrigger::LoopTrigger(void (*loop)()) : queued(false) {
+  this->loop = loop;
+  queue = NULL;
+  eventDriven = false;
+  period = 0.1;
+  measuring = false;
+  runSource = TIMER;
+  wakeupPending = false;
+  wakeupAt = 0;
+
+  for (int i = 0; i < NUM_SOURCES; i++) {
+    latency[i].runs = 0;
+    latency[i].sum = 0;
+    latency[i].max = 0;
+  }
+}
+
+void LoopTrigger::start(ros::NodeHandle& nodeHandle, bool eventDriven, double period) {
+  this->eventDriven = eventDriven;
+  this->period = period > 0 ? period : 0.1;
+  queue = nodeHandle.getCallbackQueue();
+
+  // in event mode look twice per period so a quiet spell is never stretched
+  // past one and a half periods
+  double timerPeriod = eventDriven ? this->period / 2 : this->period;
+  timer = nodeHandle.createTimer(ros::Duration(timerPeriod), &LoopTrigger::timerHandler, this);
+  wakeupTimer = nodeHandle.createTimer(ros::Duration(this->period), &LoopTrigger::wakeupHandler, this, true, false);
+}
+
+void LoopTrigger::wakeIn(double seconds) {
+  if (!eventDriven) return;
+
+  double at = Stopwatch::now() + seconds;
+  if (wakeupPending && wakeupAt <= at) return;
+
+  wakeupPending = true;
+  wakeupAt = at;
+  // a one shot timer has to be stopped before it can be set up again
+  wakeupTimer.stop();
+  wakeupTimer.setPeriod(ros::Duration(seconds));
+  wakeupTimer.start();
+}
+
+void LoopTrigger::wakeupHandler(const ros::TimerEvent& event) {
+  wakeupPending = false;
+  run(WAKEUP, ros::Time::now());
+}
+
+void LoopTrigger::trigger(Source source, const ros::Time& stamp) {
+  if (!eventDriven) return;
+
+  // one run already waiting is enough, it will see this message's data too
+  if (queued.exchange(true)) return;
+
+  queue->addCallback(boost::make_shared<Run>(this, source, stamp));
+}
+
+void LoopTrigger::timerHandler(const ros::TimerEvent& event) {
+  ros::Time now = ros::Time::now();
+  if (eventDriven && (now - lastRun).toSec() < period) return;
+  run(TIMER, now);
+}
+
+void LoopTrigger::run(Source source, const ros::Time& stamp) {
+  // triggers from here on need a run of their own
+  queued.store(false);
+
+  lastRun = ros::Time::now();
+  measuring = true;
+  runSource = source;
+  // unstamped messages count from when the run starts
+  runStamp = stamp.isZero() ? lastRun : stamp;
+
+  loop();
+
+  measuring = false;
+}
+
+void LoopTrigger::commandSent() {
+  if (!measuring) return;
+  measuring = false;
+
+  double seconds = (ros::Time::now() - runStamp).toSec();
+  Latency& l = latency[runSource];
+  l.runs++;
+  l.sum += seconds;
+  if (seconds > l.max) l.max = seconds;
+}
+
+void LoopTrigger::takeLatencies(std_msgs::Float32MultiArray& latencies) {
+  const int columns = 3;
+
+  latencies.layout.dim.resize(2);
+  latencies.layout.dim[0].label = "ODOMETRY,OBSTACLE,TARGET,WAKEUP,TIMER";
+  latencies.layout.dim[0].size = NUM_SOURCES;
+  latencies.layout.dim[0].stride = NUM_SOURCES * columns;
+  latencies.layout.dim[1].label = "runs,meanMs,maxMs";
+  latencies.layout.dim[1].size = columns;
+  latencies.layout.dim[1].stride = columns;
+  latencies.layout.data_offset = 0;
+  latencies.data.resize(NUM_SOURCES * columns);
+
+  for (int i = 0; i < NUM_SOURCES; i++) {
+    float* row = &latencies.data[i * columns];
+    row[0] = latency[i].runs;
+    row[1] = latency[i].runs > 0 ? 1000 * latency[i].sum / latency[i].runs : 0;
+    row[2] = 1000 * latency[i].max;
+
+    latency[i].runs = 0;
+    latency[i].sum = 0;
+    latency[i].max = 0;
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef LOOP_TRIGGER_H
+#define LOOP_TRIGGER_H
+
+#include <ros/ros.h>
+#include <std_msgs/Float32MultiArray.h>
+#include <boost/atomic.hpp>
+
+/**
+ * Decides when the mobility loop runs. In fixed rate mode it is a plain timer.
+ * In event driven mode the loop runs as soon as fresh odometry, an obstacle or
+ * a target sighting comes in, and a fallback timer makes sure it still runs
+ * at least once a period when the sensors go quiet.
+ *
+ * Triggers may come from any thread. The loop itself always runs on the queue
+ * of the node handle given to start(), normally the global queue serviced by
+ * ros::spin(), so it never runs twice at once. Triggers that arrive while a
+ * run is already queued are folded into that run; it sees their data anyway.
+ *
+ * Code that waits on a Stopwatch can ask for a run at the moment the wait ends
+ * with wakeIn(), so a quiet event driven loop does not sit out the fallback
+ * period.
+ *
+ * For every run the time from the stamp of the message that caused it to the
+ * first drive command of the run is recorded per source. Call commandSent()
+ * wherever the drive command is published.
+ */
+class LoopTrigger {
+
+  public:
+
+    enum Source {
+      ODOMETRY,
+      OBSTACLE,
+      TARGET,
+      WAKEUP,
+      TIMER,
+      NUM_SOURCES
+    };
+
+    LoopTrigger(void (*loop)());
+
+    // starts the timer; with eventDriven false the loop runs every period
+    // seconds, otherwise triggers drive it and period is the longest it may
+    // go without running. Runs go into nodeHandle's callback queue.
+    void start(ros::NodeHandle& nodeHandle, bool eventDriven, double period);
+
+    bool isEventDriven() {return eventDriven;}
+
+    // asks for a run because of a message stamped stamp; thread safe
+    void trigger(Source source, const ros::Time& stamp);
+
+    // runs the loop again after seconds, for code waiting on a Stopwatch.
+    // Only the earliest pending wakeup is kept; later ones are covered by the
+    // run it causes asking again. Does nothing in fixed rate mode.
+    void wakeIn(double seconds);
+
+    void commandSent();
+
+    // one row per source: [runs, mean latency ms, max latency ms], then
+    // clears the counts for the next window
+    void takeLatencies(std_msgs::Float32MultiArray& latencies);
+
+  private:
+
+    class Run;
+
+    void run(Source source, const ros::Time& stamp);
+    void timerHandler(const ros::TimerEvent& event);
+    void wakeupHandler(const ros::TimerEvent& event);
+
+    void (*loop)();
+    ros::CallbackQueueInterface* queue;
+    ros::Timer timer;
+    ros::Timer wakeupTimer;
+    bool wakeupPending;
+    double wakeupAt; // Stopwatch::now() seconds
+    bool eventDriven;
+    double period;
+
+    // a run is waiting in the queue
+    boost::atomic<bool> queued;
+
+    ros::Time lastRun;
+
+    // the run in progress, until its first drive command goes out
+    bool measuring;
+    Source runSource;
+    ros::Time runStamp;
+
+    struct Latency {
+      unsigned int runs;
+      double sum;
+      double max;
+    };
+    Latency latency[NUM_SOURCES];
+};
+
+#endif /* LOOP_TRIGGER_H */
@@ -0,0 +1,206 @@
+#include "MissionStateMachine.h"
+#include <cmath>
+
+namespace {
+
+typedef MissionStateMachine M;
+
+const M::State parents[M::NUM_STATES] = {
+  M::ROOT,      // ROOT
+  M::ROOT,      // CALIBRATING
+  M::ROOT,      // FORAGING
+  M::FORAGING,  // SEARCHING
+  M::FORAGING,  // PICKING_UP
+  M::ROOT,      // HOMEWARD
+  M::HOMEWARD,  // RETURNING
+  M::RETURNING, // FINDING_BASE
+  M::HOMEWARD   // DROPPING_OFF
+};
+
+const char* names[M::NUM_STATES] = {
+  "ROOT", "CALIBRATING", "FORAGING", "SEARCHING", "PICKING_UP",
+  "HOMEWARD", "RETURNING", "FINDING_BASE", "DROPPING_OFF"
+};
+
+struct Transition {
+  M::State from;
+  M::Event event;
+  M::State to;
+};
+
+const Transition table[] = {
+  {M::CALIBRATING,  M::CALIBRATED,      M::SEARCHING},
+  {M::SEARCHING,    M::TARGET_SELECTED, M::PICKING_UP},
+  {M::PICKING_UP,   M::PICKUP_ABORTED,  M::SEARCHING},
+  {M::FORAGING,     M::CUBE_PICKED_UP,  M::RETURNING},
+  {M::RETURNING,    M::BASE_NOT_FOUND,  M::FINDING_BASE},
+  {M::RETURNING,    M::BASE_SEEN,       M::DROPPING_OFF},
+  {M::DROPPING_OFF, M::DROPPED_OFF,     M::SEARCHING}
+};
+
+const int tableRows = sizeof(table) / sizeof(table[0]);
+
+int depth(M::State state) {
+  int d = 0;
+  while (state != M::ROOT) {
+    state = parents[state];
+    d++;
+  }
+  return d;
+}
+
+} // namespace
+
+MissionStateMachine::MissionStateMachine() {
+  active = ROOT;
+
+  for (int s = 0; s < NUM_STATES; s++) {
+    info[s].entry = NULL;
+    info[s].during = NULL;
+    info[s].exit = NULL;
+    info[s].totalSeconds = 0;
+    info[s].visits = 0;
+    for (int b = 0; b < dwellBins; b++) info[s].bins[b] = 0;
+  }
+
+  // flatten the table: a state takes its own row for an event if it has one,
+  // otherwise the row of its closest parent
+  for (int s = 0; s < NUM_STATES; s++) {
+    for (int e = 0; e < NUM_EVENTS; e++) {
+      transitions[s][e] = NUM_STATES;
+
+      State state = (State)s;
+      bool found = false;
+      while (!found) {
+        for (int r = 0; r < tableRows; r++) {
+          if (table[r].from == state && table[r].event == e) {
+            transitions[s][e] = table[r].to;
+            found = true;
+            break;
+          }
+        }
+        if (state == ROOT) break;
+        state = parents[state];
+      }
+    }
+  }
+}
+
+void MissionStateMachine::setActions(State state, Action entry, Action during, Action exit) {
+  info[state].entry = entry;
+  info[state].during = during;
+  info[state].exit = exit;
+}
+
+const char* MissionStateMachine::getStateName(State state) {
+  return names[state];
+}
+
+bool MissionStateMachine::isIn(State state) {
+  State s = active;
+  while (s != state && s != ROOT) s = parents[s];
+  return s == state;
+}
+
+void MissionStateMachine::start(State initial) {
+  ros::Time now = ros::Time::now();
+  info[ROOT].enteredAt = now;
+
+  // enter from the top down
+  State path[NUM_STATES];
+  int length = 0;
+  for (State s = initial; s != ROOT; s = parents[s]) path[length++] = s;
+
+  active = initial;
+  while (length > 0) enter(path[--length], now);
+}
+
+bool MissionStateMachine::fire(Event event) {
+  State target = transitions[active][event];
+  if (target == NUM_STATES || isIn(target)) return false;
+
+  ros::Time now = ros::Time::now();
+
+  // climb both branches to the common ancestor, collecting the states to
+  // enter on the way
+  State from = active;
+  State to = target;
+  int fromDepth = depth(from);
+  int toDepth = depth(to);
+  State path[NUM_STATES];
+  int length = 0;
+
+  while (fromDepth > toDepth) {
+    leave(from, now);
+    from = parents[from];
+    fromDepth--;
+  }
+  while (toDepth > fromDepth) {
+    path[length++] = to;
+    to = parents[to];
+    toDepth--;
+  }
+  while (from != to) {
+    leave(from, now);
+    from = parents[from];
+    path[length++] = to;
+    to = parents[to];
+  }
+
+  // the entry actions already see the new state
+  active = target;
+  while (length > 0) enter(path[--length], now);
+  return true;
+}
+
+void MissionStateMachine::tick() {
+  State s = active;
+  while (info[s].during == NULL && s != ROOT) s = parents[s];
+  if (info[s].during) info[s].during();
+}
+
+void MissionStateMachine::enter(State state, const ros::Time& now) {
+  info[state].enteredAt = now;
+  info[state].visits++;
+  if (info[state].entry) info[state].entry();
+}
+
+void MissionStateMachine::leave(State state, const ros::Time& now) {
+  if (info[state].exit) info[state].exit();
+
+  double seconds = (now - info[state].enteredAt).toSec();
+  info[state].totalSeconds += seconds;
+
+  // frexp puts [0.5s, 1s) in bin 1, [1s, 2s) in bin 2 and so on
+  int exponent = 0;
+  frexp(seconds * 2, &exponent);
+  if (exponent < 0) exponent = 0;
+  if (exponent > dwellBins - 1) exponent = dwellBins - 1;
+  info[state].bins[exponent]++;
+}
+
+void MissionStateMachine::getDwellHistogram(std_msgs::Float32MultiArray& histogram) {
+  const int rows = NUM_STATES - 1;
+  const int columns = dwellBins + 2;
+  ros::Time now = ros::Time::now();
+
+  histogram.layout.dim.resize(2);
+  histogram.layout.dim[0].label = "CALIBRATING,FORAGING,SEARCHING,PICKING_UP,HOMEWARD,RETURNING,FINDING_BASE,DROPPING_OFF";
+  histogram.layout.dim[0].size = rows;
+  histogram.layout.dim[0].stride = rows * columns;
+  histogram.layout.dim[1].label = "seconds,visits,bins";
+  histogram.layout.dim[1].size = columns;
+  histogram.layout.dim[1].stride = columns;
+  histogram.layout.data_offset = 0;
+  histogram.data.resize(rows * columns);
+
+  for (int s = 1; s < NUM_STATES; s++) {
+    float* row = &histogram.data[(s - 1) * columns];
+    double seconds = info[s].totalSeconds;
+    if (isIn((State)s)) seconds += (now - info[s].enteredAt).toSec();
+
+    row[0] = seconds;
+    row[1] = info[s].visits;
+    for (int b = 0; b < dwellBins; b++) row[b + 2] = info[s].bins[b];
+  }
+}
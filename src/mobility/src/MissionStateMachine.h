@@ -0,0 +1,113 @@
+#ifndef MISSION_STATE_MACHINE_H
+#define MISSION_STATE_MACHINE_H
+
+#include <ros/ros.h>
+#include <std_msgs/Float32MultiArray.h>
+
+/**
+ * Decides which controller drives the rover. The states form a small tree:
+ *
+ *   CALIBRATING
+ *   FORAGING        no cube in the claw
+ *     SEARCHING
+ *     PICKING_UP
+ *   HOMEWARD        carrying a cube
+ *     RETURNING     driving to where we think the nest is
+ *       FINDING_BASE  it was not there, spiral for it
+ *     DROPPING_OFF
+ *
+ * Transitions live in one table of (from, event, to) rows. A row on a parent
+ * state applies to all of its children unless a child has its own row, and the
+ * table is flattened up front so fire() is a single lookup. Firing an event
+ * that leads to a state the machine is already in does nothing.
+ *
+ * Each state may have entry, during and exit actions. A transition runs the
+ * exit actions from the active state up to the common ancestor, then the
+ * entry actions down to the new state. tick() runs the during action of the
+ * active state, or of its nearest ancestor that has one.
+ *
+ * Every visit to a state is timed. The dwell times go into a histogram per
+ * state with power of two bins, from under half a second to over two minutes.
+ */
+class MissionStateMachine {
+
+  public:
+
+    enum State {
+      ROOT,
+      CALIBRATING,
+      FORAGING,
+      SEARCHING,
+      PICKING_UP,
+      HOMEWARD,
+      RETURNING,
+      FINDING_BASE,
+      DROPPING_OFF,
+      NUM_STATES
+    };
+
+    enum Event {
+      CALIBRATED,
+      TARGET_SELECTED,
+      PICKUP_ABORTED,
+      CUBE_PICKED_UP,
+      BASE_NOT_FOUND,
+      BASE_SEEN,
+      DROPPED_OFF,
+      NUM_EVENTS
+    };
+
+    typedef void (*Action)();
+
+    // histogram bins: < 0.5s, < 1s, < 2s, ... < 128s, >= 128s
+    static const int dwellBins = 10;
+
+    MissionStateMachine();
+
+    // any of the actions may be NULL
+    void setActions(State state, Action entry, Action during, Action exit);
+
+    // enters initial (and its parents) from ROOT
+    void start(State initial);
+
+    // returns true if the event caused a transition
+    bool fire(Event event);
+
+    void tick();
+
+    State getState() {return active;}
+    const char* getStateName() {return getStateName(active);}
+    static const char* getStateName(State state);
+
+    // true if state is the active state or one of its parents
+    bool isIn(State state);
+
+    // one row per state except ROOT, in enum order:
+    // [seconds in state, visits, bin 0 .. bin dwellBins-1]
+    // the visit in progress counts towards the seconds but not the bins
+    void getDwellHistogram(std_msgs::Float32MultiArray& histogram);
+
+  private:
+
+    struct StateInfo {
+      Action entry;
+      Action during;
+      Action exit;
+      ros::Time enteredAt;
+      double totalSeconds;
+      unsigned int visits;
+      unsigned int bins[dwellBins];
+    };
+
+    void enter(State state, const ros::Time& now);
+    void leave(State state, const ros::Time& now);
+
+    State active;
+    StateInfo info[NUM_STATES];
+
+    // target for each (state, event) after inheriting the parents' rows,
+    // NUM_STATES where the event is ignored
+    State transitions[NUM_STATES][NUM_EVENTS];
+};
+
+#endif /* MISSION_STATE_MACHINE_H */
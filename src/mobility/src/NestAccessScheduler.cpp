@@ -0,0 +1,192 @@
+#include "NestAccessScheduler.h"
+#include "AngleMath.h"
+#include <cmath>
+#include <cstring>
+
+NestAccessScheduler::NestAccessScheduler(ArenaFrame& frame, std::string roverName, double leaseSeconds, int maxConcurrent, double maxHoldSeconds) : frame(frame) {
+  strncpy(name, roverName.c_str(), nameLength - 1);
+  name[nameLength - 1] = '\0';
+  this->leaseSeconds = leaseSeconds;
+  this->maxConcurrent = maxConcurrent > 0 ? maxConcurrent : 1;
+  this->maxHoldSeconds = maxHoldSeconds;
+
+  for (int i = 0; i < maxRequests; i++) {
+    others[i].used = false;
+  }
+  requesting = false;
+  eta = 0;
+  side = EAST;
+  penalty = 0;
+  grantedSince = -1;
+  droppingOff = false;
+}
+
+void NestAccessScheduler::advertise(ros::NodeHandle& nodeHandle) {
+  requestPublish = nodeHandle.advertise<std_msgs::Float64MultiArray>("/nestAccess", 10);
+  requestSubscriber = nodeHandle.subscribe("/nestAccess", 20, &NestAccessScheduler::requestHandler, this);
+}
+
+bool NestAccessScheduler::before(double etaA, const char* nameA, double etaB, const char* nameB) {
+  if (etaA != etaB) return etaA < etaB;
+  return strcmp(nameA, nameB) < 0;
+}
+
+// the arena frame is centered on the nest, so the side is the quadrant the
+// rover is in
+int NestAccessScheduler::sideOf(double x, double y) {
+  double arenaX, arenaY;
+  frame.toArena(x, y, arenaX, arenaY);
+  double angle = angle_math::wrapPositive(atan2(arenaY, arenaX) + M_PI_4);
+  return (int)(angle / M_PI_2) & 3;
+}
+
+void NestAccessScheduler::publish(bool requesting) {
+  std_msgs::Float64MultiArray message;
+  std_msgs::MultiArrayDimension sender;
+  sender.label = name;
+  sender.size = 4;
+  sender.stride = 1;
+  message.layout.dim.push_back(sender);
+
+  message.data.push_back(requesting ? 1 : 0);
+  message.data.push_back(eta - ros::Time::now().toSec());
+  message.data.push_back(side);
+  message.data.push_back(leaseSeconds);
+  requestPublish.publish(message);
+}
+
+void NestAccessScheduler::request(double x, double y, double etaSeconds) {
+  if (!requesting) {
+    penalty = 0;
+    grantedSince = -1;
+    droppingOff = false;
+  }
+  requesting = true;
+  renew(x, y, etaSeconds);
+}
+
+void NestAccessScheduler::renew(double x, double y, double etaSeconds) {
+  if (!requesting) return;
+  double now = ros::Time::now().toSec();
+  eta = now + etaSeconds + penalty;
+  if (!frame.isValid()) return;
+  side = sideOf(x, y);
+
+  int slot;
+  bool granted;
+  arbitrate(slot, granted);
+  if (!granted || droppingOff) {
+    grantedSince = granted ? now : -1;
+  } else if (grantedSince < 0) {
+    grantedSince = now;
+  } else if (maxHoldSeconds > 0 && now - grantedSince > maxHoldSeconds) {
+    // held the nest too long without getting there; let the next rover in
+    // and queue up again behind it
+    publish(false);
+    penalty += maxHoldSeconds;
+    eta += maxHoldSeconds;
+    grantedSince = -1;
+  }
+  publish(true);
+}
+
+void NestAccessScheduler::release() {
+  if (!requesting) return;
+  requesting = false;
+  if (frame.isValid()) publish(false);
+}
+
+void NestAccessScheduler::setDroppingOff(bool droppingOff) {
+  this->droppingOff = droppingOff;
+  // a drop off that did not work out starts the hold over
+  if (!droppingOff && grantedSince >= 0) grantedSince = ros::Time::now().toSec();
+}
+
+void NestAccessScheduler::arbitrate(int& slot, bool& granted) {
+  double now = ros::Time::now().toSec();
+
+  // the live requests in arrival order, ours included (index -1)
+  int order[maxRequests + 1];
+  int count = 0;
+  for (int i = -1; i < maxRequests; i++) {
+    if (i >= 0 && (!others[i].used || others[i].expiry < now)) continue;
+    double entryEta = i < 0 ? eta : others[i].eta;
+    const char* entryName = i < 0 ? name : others[i].owner;
+
+    int j = count++;
+    for (; j > 0; j--) {
+      int k = order[j - 1];
+      if (!before(entryEta, entryName, k < 0 ? eta : others[k].eta, k < 0 ? name : others[k].owner)) break;
+      order[j] = k;
+    }
+    order[j] = i;
+  }
+
+  // first come first served, one rover per side and maxConcurrent in all
+  int sidesTaken = 0;
+  int inside = 0;
+  for (int j = 0; j < count; j++) {
+    int entrySide = order[j] < 0 ? side : others[order[j]].side;
+    bool entryGranted = inside < maxConcurrent && !(sidesTaken & (1 << entrySide));
+    if (entryGranted) {
+      inside++;
+      sidesTaken |= 1 << entrySide;
+    }
+    if (order[j] < 0) {
+      slot = j;
+      granted = entryGranted;
+      return;
+    }
+  }
+}
+
+bool NestAccessScheduler::isGranted() {
+  if (!requesting || !frame.isValid()) return true;
+
+  int slot;
+  bool granted;
+  arbitrate(slot, granted);
+  return granted;
+}
+
+int NestAccessScheduler::getSlot() {
+  if (!requesting) return -1;
+
+  int slot;
+  bool granted;
+  arbitrate(slot, granted);
+  return slot;
+}
+
+void NestAccessScheduler::requestHandler(const std_msgs::Float64MultiArray::ConstPtr& message) {
+  if (message->layout.dim.empty() || message->data.size() < 4) return;
+
+  const std::string& sender = message->layout.dim[0].label;
+  if (sender == name) return;
+
+  bool requested = message->data[0] != 0;
+  double now = ros::Time::now().toSec();
+
+  int existing = -1;
+  int free = -1;
+  for (int i = 0; i < maxRequests; i++) {
+    if (others[i].used && others[i].expiry >= now && strcmp(others[i].owner, sender.c_str()) == 0) existing = i;
+    else if (free < 0 && (!others[i].used || others[i].expiry < now)) free = i;
+  }
+
+  if (!requested) {
+    if (existing >= 0) others[existing].used = false;
+    return;
+  }
+
+  int slot = existing >= 0 ? existing : free;
+  if (slot < 0) return; // table full of live requests; they will wait on us
+
+  Request& request = others[slot];
+  request.used = true;
+  strncpy(request.owner, sender.c_str(), nameLength - 1);
+  request.owner[nameLength - 1] = '\0';
+  request.eta = now + message->data[1];
+  request.side = (int)message->data[2] & 3;
+  request.expiry = now + message->data[3];
+}
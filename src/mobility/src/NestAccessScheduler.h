@@ -0,0 +1,104 @@
+#ifndef NEST_ACCESS_SCHEDULER_H
+#define NEST_ACCESS_SCHEDULER_H
+
+#include <string>
+#include <ros/ros.h>
+#include <std_msgs/Float64MultiArray.h>
+#include "ArenaFrame.h"
+
+/**
+ * Keeps returning rovers from jamming at the collection zone. A rover headed
+ * home requests a slot on the shared /nestAccess topic with its estimated
+ * arrival time and the side of the nest it is coming from (east, north, west
+ * or south of it, in the arena frame). Like a target claim, the request is a
+ * lease that the rover renews until it has dropped off and backed out.
+ *
+ * Every rover runs the same arbitration over the same requests, so they all
+ * agree without a leader: requests are served in order of arrival time (ties
+ * go to the smaller name), and a request gets the nest when fewer than
+ * maxConcurrent earlier ones have it and none of those came from the same
+ * side. Rovers that do not get it hold at a standoff distance.
+ *
+ * The arrival time is worked out again from the rover's distance on every
+ * renewal, so a rover that gets held up falls back behind the ones that are
+ * closer. A rover that has had the nest for maxHoldSeconds without starting
+ * its drop off gives it up and asks again, maxHoldSeconds further back in
+ * the line each time, so one stuck rover cannot keep the others out.
+ *
+ * Message layout (Float64MultiArray, sender name in layout.dim[0].label):
+ *   [type (1 request, 0 release), seconds to arrival, side, lease seconds]
+ *
+ * The rovers share no clock, so arrival times travel as seconds from now
+ * and each receiver turns them into a time on its own clock as they arrive.
+ */
+class NestAccessScheduler {
+
+  public:
+
+    static const int EAST = 0, NORTH = 1, WEST = 2, SOUTH = 3;
+
+    NestAccessScheduler(ArenaFrame& frame, std::string roverName, double leaseSeconds, int maxConcurrent, double maxHoldSeconds);
+
+    void advertise(ros::NodeHandle& nodeHandle);
+
+    // asks for the nest for a rover at odom position (x, y), etaSeconds away
+    void request(double x, double y, double etaSeconds);
+
+    // keeps the request alive and its arrival time and side current, about
+    // once a second
+    void renew(double x, double y, double etaSeconds);
+    void release();
+
+    // the hold limit only runs until the drop off starts
+    void setDroppingOff(bool droppingOff);
+
+    // true when we may go in, and whenever there is nothing to coordinate:
+    // no request, or no shared frame yet
+    bool isGranted();
+
+    // our place in the queue, 0 is next; -1 without a request
+    int getSlot();
+    int getSide() {return side;}
+
+  private:
+
+    static const int maxRequests = 16;
+    static const int nameLength = 32;
+
+    struct Request {
+      bool used;
+      char owner[nameLength];
+      double eta; // on our clock
+      int side;
+      double expiry;
+    };
+
+    void requestHandler(const std_msgs::Float64MultiArray::ConstPtr& message);
+    void publish(bool requesting);
+    int sideOf(double x, double y);
+
+    // runs the arbitration; our slot, and whether it has the nest
+    void arbitrate(int& slot, bool& granted);
+
+    static bool before(double etaA, const char* nameA, double etaB, const char* nameB);
+
+    ArenaFrame& frame;
+    char name[nameLength];
+    double leaseSeconds;
+    int maxConcurrent;
+    double maxHoldSeconds;
+
+    bool requesting;
+    double eta;
+    int side;
+    double penalty;      // seconds added to our arrival time for holds given up
+    double grantedSince; // when we got the nest, negative while we do not have it
+    bool droppingOff;
+
+    Request others[maxRequests];
+
+    ros::Publisher requestPublish;
+    ros::Subscriber requestSubscriber;
+};
+
+#endif /* NEST_ACCESS_SCHEDULER_H */
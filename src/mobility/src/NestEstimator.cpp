@@ -0,0 +1,104 @@
+#include "NestEstimator.h"
+#include "Stopwatch.h"
+#include <cmath>
+
+namespace {
+
+// the tags in view can be anywhere on the nest's edge, so even a close
+// sighting leaves a quarter meter of doubt about the center
+const float sigmaSighting = 0.25;
+const float sigmaPerMeter = 0.10;
+
+// the tags seen are on the near edge; the center is half the nest further on
+const float nestHalfSize = 0.5;
+
+// frames seconds apart are far from independent looks at the nest, so
+// sightings are taken at most this often, and together they never place
+// the center more closely than the nest's half size
+const double sightingInterval = 1.0;
+const float sigmaSightingsMin = nestHalfSize;
+
+// a drop off happens well inside the nest
+const float sigmaDropOff = 0.10;
+
+// odometry drift, square meters per second
+const float driftPerSecond = 0.001;
+
+} // namespace
+
+NestEstimator::NestEstimator(float sigmaMax) {
+  this->sigmaMax = sigmaMax > 0 ? sigmaMax : 1.0;
+  x = 0;
+  y = 0;
+  variance = this->sigmaMax * this->sigmaMax;
+  lastUpdate = Stopwatch::now();
+  sightings = 0;
+  lastSighting = -sightingInterval;
+  seeded = false;
+}
+
+void NestEstimator::seed(float x, float y, float sigma) {
+  this->x = x;
+  this->y = y;
+  variance = sigma * sigma;
+  lastUpdate = Stopwatch::now();
+  seeded = true;
+}
+
+void NestEstimator::predict() {
+  double now = Stopwatch::now();
+  double dt = now - lastUpdate;
+  if (dt > 0) variance += driftPerSecond * dt;
+  lastUpdate = now;
+}
+
+void NestEstimator::fuse(float measuredX, float measuredY, float sigma) {
+  predict();
+  float measurementVariance = sigma * sigma;
+  float gain = variance / (variance + measurementVariance);
+  x += gain * (measuredX - x);
+  y += gain * (measuredY - y);
+  variance *= 1 - gain;
+}
+
+void NestEstimator::addSighting(const geometry_msgs::Pose2D& rover, const geometry_msgs::Point& tag) {
+  double now = Stopwatch::now();
+  if (now - lastSighting < sightingInterval) return;
+  lastSighting = now;
+
+  // same camera geometry as the cube detections in PickUpController
+  double dist = hypot(tag.z, tag.y);
+  dist = dist > 0.195 ? sqrt(dist*dist - 0.195*0.195) : 0;
+  double yawError = atan((tag.x + 0.020) / dist) * 1.05;
+  if (dist == 0) yawError = 0;
+
+  float centerX = rover.x + (dist + nestHalfSize) * cos(rover.theta - yawError);
+  float centerY = rover.y + (dist + nestHalfSize) * sin(rover.theta - yawError);
+
+  predict();
+  float before = variance;
+  fuse(centerX, centerY, sigmaSighting + sigmaPerMeter * dist);
+  float minVariance = sigmaSightingsMin * sigmaSightingsMin;
+  if (variance < minVariance) variance = before < minVariance ? before : minVariance;
+  sightings++;
+}
+
+void NestEstimator::addDropOff(const geometry_msgs::Pose2D& rover) {
+  fuse(rover.x, rover.y, sigmaDropOff);
+}
+
+void NestEstimator::addMiss() {
+  predict();
+  variance += 0.25 * sigmaMax * sigmaMax;
+}
+
+float NestEstimator::getSigma() {
+  predict();
+  return sqrt(variance);
+}
+
+float NestEstimator::getConfidence() {
+  predict();
+  float c = 1 - sqrt(variance) / sigmaMax;
+  return c > 0 ? c : 0;
+}
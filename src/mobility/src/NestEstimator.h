@@ -0,0 +1,69 @@
+#ifndef NEST_ESTIMATOR_H
+#define NEST_ESTIMATOR_H
+
+#include <geometry_msgs/Pose2D.h>
+#include <geometry_msgs/Point.h>
+
+/**
+ * Where this rover thinks the collection zone is, in odom coordinates, and how
+ * sure it is.
+ *
+ * A frame with nest (256) tags in it is a sighting: the tags are placed
+ * using the rover pose at the time, the same way cubes are, and their
+ * centroid, moved half a nest further along the line of sight since the
+ * tags in view are on the near edge, goes into a constant position Kalman
+ * filter. Sightings are taken at most once a second and on their own never
+ * bring the standard deviation below the nest's half size, as successive
+ * frames of the same edge are hardly independent. Sightings from far away
+ * count for less, and a drop off, made inside the nest, counts for the
+ * most. Between sightings the variance grows to allow for odometry drift, and
+ * arriving where the nest should be without seeing it grows it a lot.
+ *
+ * Confidence is 1 when the position is known exactly and falls to 0 once its
+ * standard deviation reaches sigmaMax. Below the caller's threshold the
+ * estimate is only good as the center of a search.
+ */
+class NestEstimator {
+
+  public:
+
+    NestEstimator(float sigmaMax);
+
+    // starting guess, e.g. where the rover was placed
+    void seed(float x, float y, float sigma);
+
+    // nest tags seen from rover; tag is their mean position in the camera
+    // frame, as the tag detector gives it
+    void addSighting(const geometry_msgs::Pose2D& rover, const geometry_msgs::Point& tag);
+
+    // the cube was dropped at rover, so that is inside the nest
+    void addDropOff(const geometry_msgs::Pose2D& rover);
+
+    // got to the estimate and no nest tags were in sight
+    void addMiss();
+
+    float getX() {return x;}
+    float getY() {return y;}
+    float getConfidence();
+    // standard deviation of the position, meters
+    float getSigma();
+    int getSightings() {return sightings;}
+    bool isSeeded() {return seeded;}
+
+  private:
+
+    void predict();
+    void fuse(float x, float y, float sigma);
+
+    float x;
+    float y;
+    float variance;  // per axis, square meters
+    double lastUpdate; // Stopwatch::now()
+    double lastSighting;
+    int sightings;
+    bool seeded;
+
+    float sigmaMax;
+};
+
+#endif /* NEST_ESTIMATOR_H */
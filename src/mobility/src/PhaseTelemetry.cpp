@@ -0,0 +1,148 @@
+#include "PhaseTelemetry.h"
+#include "Stopwatch.h"
+#include <cmath>
+
+namespace {
+
+// histogram resolution, seconds
+const double bucketUnit = 0.01;
+
+const int transitionColumns = 6;
+
+} // namespace
+
+PhaseTelemetry::PhaseTelemetry(double windowSeconds) {
+  this->windowSeconds = windowSeconds > 0 ? windowSeconds : 60;
+  rows = 0;
+  pendingCount = 0;
+  dropped = 0;
+  historyStart = 0;
+  historyCount = 0;
+}
+
+int PhaseTelemetry::addController(int phases) {
+  firstRow.push_back(rows);
+  phaseCount.push_back(phases);
+  rows += phases;
+  totals.assign(rows * (2 + buckets), 0);
+  return firstRow.size() - 1;
+}
+
+void PhaseTelemetry::advertise(ros::NodeHandle& nodeHandle, const std::string& roverName) {
+  transitionsPublish = nodeHandle.advertise<std_msgs::Float32MultiArray>(roverName + "/phaseTransitions", 10);
+  histogramPublish = nodeHandle.advertise<std_msgs::Float32MultiArray>(roverName + "/phaseHistograms", 1, true);
+
+  // sized once for the worst case, so flush() only ever shrinks them
+  transitionsMessage.layout.dim.resize(2);
+  transitionsMessage.layout.dim[0].label = "transition";
+  transitionsMessage.layout.dim[1].label = "controller,from,to,seconds,failed,time";
+  transitionsMessage.layout.dim[1].size = transitionColumns;
+  transitionsMessage.layout.dim[1].stride = transitionColumns;
+  transitionsMessage.data.reserve(pendingSize * transitionColumns);
+
+  int columns = 4 + buckets;
+  histogramMessage.layout.dim.resize(2);
+  histogramMessage.layout.dim[0].label = "phase";
+  histogramMessage.layout.dim[0].size = rows;
+  histogramMessage.layout.dim[0].stride = rows * columns;
+  histogramMessage.layout.dim[1].label = "controller,phase,visits,failures,buckets";
+  histogramMessage.layout.dim[1].size = columns;
+  histogramMessage.layout.dim[1].stride = columns;
+  histogramMessage.data.resize(rows * columns);
+  for (int c = 0; c < (int) firstRow.size(); c++) {
+    for (int p = 0; p < phaseCount[c]; p++) {
+      histogramMessage.data[(firstRow[c] + p) * columns] = c;
+      histogramMessage.data[(firstRow[c] + p) * columns + 1] = p;
+    }
+  }
+}
+
+void PhaseTelemetry::record(int controller, int from, int to, double seconds, bool failed) {
+  if (pendingCount == pendingSize) {
+    dropped++;
+    return;
+  }
+
+  Transition& transition = pending[pendingCount++];
+  transition.controller = controller;
+  transition.from = from;
+  transition.to = to;
+  transition.failed = failed;
+  transition.seconds = seconds;
+  transition.time = Stopwatch::now();
+}
+
+int PhaseTelemetry::bucketFor(double seconds) {
+  double units = seconds / bucketUnit;
+  if (!(units >= 0)) return 0; // negative or NaN
+  if (units < 8) return (int) units;
+
+  int exponent;
+  double mantissa = frexp(units, &exponent); // units = mantissa * 2^exponent, mantissa in [0.5, 1)
+  int bucket = 8 + (exponent - 4) * 4 + (int) (mantissa * 8 - 4);
+  return bucket < buckets ? bucket : buckets - 1;
+}
+
+void PhaseTelemetry::dropOldest() {
+  const Sample& sample = history[historyStart];
+  unsigned int* row = &totals[sample.row * (2 + buckets)];
+  row[0]--;
+  if (sample.failed) row[1]--;
+  row[2 + sample.bucket]--;
+
+  historyStart = (historyStart + 1) % historySize;
+  historyCount--;
+}
+
+void PhaseTelemetry::expire(double now) {
+  while (historyCount > 0 && now - history[historyStart].time > windowSeconds) dropOldest();
+}
+
+void PhaseTelemetry::flush() {
+  double now = Stopwatch::now();
+  expire(now);
+
+  transitionsMessage.layout.dim[0].size = pendingCount;
+  transitionsMessage.layout.dim[0].stride = pendingCount * transitionColumns;
+  transitionsMessage.layout.data_offset = dropped;
+  transitionsMessage.data.resize(pendingCount * transitionColumns);
+
+  for (int i = 0; i < pendingCount; i++) {
+    const Transition& transition = pending[i];
+    float* out = &transitionsMessage.data[i * transitionColumns];
+    out[0] = transition.controller;
+    out[1] = transition.from;
+    out[2] = transition.to;
+    out[3] = transition.seconds;
+    out[4] = transition.failed;
+    out[5] = transition.time;
+
+    if (transition.controller < 0 || transition.controller >= (int) firstRow.size()) continue;
+    if (transition.from < 0 || transition.from >= phaseCount[transition.controller]) continue;
+
+    // a full window gives up its oldest sample early
+    if (historyCount == historySize) dropOldest();
+
+    Sample& sample = history[(historyStart + historyCount++) % historySize];
+    sample.row = firstRow[transition.controller] + transition.from;
+    sample.bucket = bucketFor(transition.seconds);
+    sample.failed = transition.failed;
+    sample.time = transition.time;
+
+    unsigned int* row = &totals[sample.row * (2 + buckets)];
+    row[0]++;
+    if (sample.failed) row[1]++;
+    row[2 + sample.bucket]++;
+  }
+
+  if (pendingCount > 0) transitionsPublish.publish(transitionsMessage);
+  pendingCount = 0;
+
+  int columns = 4 + buckets;
+  for (int r = 0; r < rows; r++) {
+    for (int i = 0; i < 2 + buckets; i++) {
+      histogramMessage.data[r * columns + 2 + i] = totals[r * (2 + buckets) + i];
+    }
+  }
+  histogramPublish.publish(histogramMessage);
+}
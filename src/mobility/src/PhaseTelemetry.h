@@ -0,0 +1,99 @@
+#ifndef PHASE_TELEMETRY_H
+#define PHASE_TELEMETRY_H
+
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include <std_msgs/Float32MultiArray.h>
+
+/**
+ * Machine readable timing for the pickup and dropoff phases.
+ *
+ * Controllers call record() on every state change. That only copies a few
+ * numbers into a fixed ring buffer; no strings, no allocation. flush(), from
+ * the 1 Hz status timer, drains the buffer and publishes two messages:
+ *
+ * <rover>/phaseTransitions, one row per transition since the last flush:
+ *   [controller, from phase, to phase, seconds in from phase, failed, time]
+ *   to phase is -1 when the sequence ended (reset). failed is 1 when the
+ *   controller said so, or when a sequence was cut short.
+ *
+ * <rover>/phaseHistograms, one row per (controller, phase) over the last
+ * windowSeconds: [controller, phase, visits, failures, bucket 0 ..]
+ *   Buckets are HDR style: 10 ms units, the first 8 buckets one unit wide,
+ *   then 4 buckets per doubling. Bucket 8 + 4k + s starts at
+ *   (4 + s) * 2^(k+1) units. The last bucket also takes everything longer.
+ *
+ * If more than pendingSize transitions come in between flushes the extra
+ * ones are dropped. The running count of those goes in the transitions
+ * message as layout.data_offset.
+ */
+class PhaseTelemetry {
+
+  public:
+
+    static const int buckets = 52;
+
+    PhaseTelemetry(double windowSeconds);
+
+    // setup, before advertise(); returns the controller id for record()
+    int addController(int phases);
+
+    void advertise(ros::NodeHandle& nodeHandle, const std::string& roverName);
+
+    // hot path
+    void record(int controller, int from, int to, double seconds, bool failed);
+
+    void flush();
+
+  private:
+
+    struct Transition {
+      short controller;
+      short from;
+      short to;
+      bool failed;
+      float seconds;
+      double time; // Stopwatch::now()
+    };
+
+    struct Sample {
+      int row;
+      int bucket;
+      bool failed;
+      double time;
+    };
+
+    static const int pendingSize = 64;
+    static const int historySize = 512;
+
+    static int bucketFor(double seconds);
+    void dropOldest();
+    void expire(double now);
+
+    double windowSeconds;
+
+    // first histogram row of each controller, and its phase count
+    std::vector<int> firstRow;
+    std::vector<int> phaseCount;
+    int rows;
+
+    Transition pending[pendingSize];
+    int pendingCount;
+    unsigned int dropped;
+
+    // what is in the window, oldest first
+    Sample history[historySize];
+    int historyStart;
+    int historyCount;
+
+    // running totals over the window, rows * (2 + buckets)
+    std::vector<unsigned int> totals;
+
+    std_msgs::Float32MultiArray transitionsMessage;
+    std_msgs::Float32MultiArray histogramMessage;
+    ros::Publisher transitionsPublish;
+    ros::Publisher histogramPublish;
+};
+
+#endif /* PHASE_TELEMETRY_H */
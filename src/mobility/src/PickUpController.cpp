@@ -1,6 +1,9 @@
 #include "PickUpController.h"
+#include "AngleMath.h"
+#include <sstream>
+#include <vector>
 
-PickUpController::PickUpController() {
+PickUpController::PickUpController() : tracker(0.15, 3.0, 0.1) {
     nTargetsSeen = 0;
     blockYawError = 0;
     blockDist = 0;
@@ -20,6 +23,27 @@ state = FIXING_CAMERA;
 blockBlock = false;
 openCVThinksCubeIsHeld = false;
 result.foundACluster = false;
+result.targetCount = 0;
+result.targetX = 0;
+result.targetY = 0;
+result.allClaimed = false;
+claims = NULL;
+selectedTrack = -1;
+trackedTarget = -1;
+trackerConfidence = 0.7;
+
+visualServo = false;
+std::vector<double> schedule;
+//range, yaw gain, speed
+schedule.push_back(0.2); schedule.push_back(1.5); schedule.push_back(0.08);
+schedule.push_back(0.5); schedule.push_back(1.0); schedule.push_back(0.15);
+schedule.push_back(1.0); schedule.push_back(0.8); schedule.push_back(0.25);
+setServoSchedule(schedule, 0.25);
+for (int i = 0; i < NUM_STATES; i++)
+	phaseSeconds[i] = 0;
+telemetry = NULL;
+telemetryId = 0;
+sequenceActive = false;
 
 lastCmdVel = -0.3141719;//unique number in range of motors
 lastAngleError = lastCmdVel;
@@ -59,7 +83,6 @@ result.fingerAngle = -1;
 result.wristAngle = -1;
 
 float duration;
-ros::Duration timeDifferenceObject;
 
 float timeToEnsureStraightening;
 
@@ -68,37 +91,25 @@ switch(state) {
 //put target in center of camera
 case (FIXING_CAMERA):
 {
-float myAngle;
-float goodAngle;
-float twopi = 2*3.1415926535;
-float pi = twopi / 2;
 float tolerance = 0.030;
 
-myAngle = currentLocation.theta;
-goodAngle = correctAngleBearingToPickUpCube;
-while(myAngle < 0)
-	myAngle = myAngle + twopi;
-while (myAngle > twopi)
-	myAngle = myAngle - twopi;
-while (goodAngle < 0)
-	goodAngle = goodAngle + twopi;
-while (goodAngle > twopi)
-	goodAngle = goodAngle - twopi;
+//once the tracker has the cube pinned down, aim at its filtered position
+//instead of the snapshot from the first sighting
+TargetTracker::Estimate estimate;
+bool confident = getTargetEstimate(currentLocation, estimate) && estimate.confidence >= trackerConfidence;
+if (confident)
+	correctAngleBearingToPickUpCube = estimate.bearing;
 
-
-
-float blockYawError = myAngle - goodAngle;
-if (blockYawError < 0)
+//no need to line up first, the servo steers on the way in
+if (confident && visualServo)
 {
-while (blockYawError < -pi)
-	blockYawError = blockYawError + twopi;
+	setState(SERVOING_TO_CUBE);
+	servo(currentLocation, estimate);
+	break;
 }
-else if (blockYawError > 0)
-{
-while(blockYawError > pi)
-	blockYawError = blockYawError - twopi;
 
-}
+//how far we are turned past the bearing to the cube, between -pi and pi
+float blockYawError = angle_math::difference(currentLocation.theta, correctAngleBearingToPickUpCube);
 		if (blockYawError > tolerance)
 		   result.angleError = 0.275;	
 		else if (blockYawError < -tolerance)
@@ -106,21 +117,45 @@ while(blockYawError > pi)
 		else //if its good!
 		{
 			result.angleError = 0;
-			if (checkedOnce == true)
+			if (confident)
+			{
+				//the filter already settled the jitter, no need to wait and look again
+				distanceToBlockUponFirstSight = estimate.range;
+				setState(APPROACHING_CUBE);
+			}
+			else if (checkedOnce == true)
 				setState(APPROACHING_CUBE);
 			else
 				setState(WAITING_AND_CHECKING_CAMERA_AGAIN);//steven version of PID
-			omniTimerStartingTime = ros::Time::now();
+			omniTimer.restart();
 		}
 		result.cmdVel = 0;
 		result.fingerAngle = FINGERS_OPEN;
 		result.wristAngle = WRIST_DOWN;
 }//end case FIXING_CAMERA
 break;
+case (SERVOING_TO_CUBE):
+{
+//hold on to the servo until the estimate gets really shaky, then go back to
+//the discrete steps
+TargetTracker::Estimate estimate;
+if (getTargetEstimate(currentLocation, estimate) && estimate.confidence >= trackerConfidence / 2)
+{
+	servo(currentLocation, estimate);
+}
+else
+{
+	checkedOnce = false;
+	result.cmdVel = 0;
+	result.angleError = 0;
+	setState(FIXING_CAMERA);
+}
+}
+break;
+
 case (WAITING_AND_CHECKING_CAMERA_AGAIN):
 duration = 1.0;
-timeDifferenceObject = ros::Time::now() - omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!omniTimer.waitFor(duration))
 {
 //do nothing
 }
@@ -147,8 +182,7 @@ checkedOnce = false;
 
 duration = distanceToBlockUponFirstSight / calibrator.pickupSpeed;
 
-timeDifferenceObject = ros::Time::now() - omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!omniTimer.waitFor(duration))
 {
 result.cmdVel = PICKUP_VELOCITY;//inch forward
 result.angleError = 0;
@@ -158,7 +192,7 @@ else
 //it is done travelling
 result.cmdVel = 0;
 result.angleError = 0;
-state = PICKING_UP_CUBE;
+setState(PICKING_UP_CUBE);
 }
 break;
 
@@ -167,15 +201,14 @@ case (PICKING_UP_CUBE):
 // close fingers
 result.fingerAngle = 0;
 
-omniTimerStartingTime = ros::Time::now();//reset the timer again
-state = WAIT_BEFORE_RAISING_WRIST;
+omniTimer.restart();//reset the timer again
+setState(WAIT_BEFORE_RAISING_WRIST);
 
 break;
 
 case (WAIT_BEFORE_RAISING_WRIST):
 duration = 1.0;
-timeDifferenceObject = ros::Time::now() - omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!omniTimer.waitFor(duration))
 {
 
 }//do nothing; wait
@@ -183,24 +216,23 @@ else
 {
 //raise wrist back up
 result.wristAngle = 0;
-state = VERIFYING_PICKUP;
+setState(VERIFYING_PICKUP);
 }
 break;
 
 case (VERIFYING_PICKUP):
 duration = 2.0;
-timeDifferenceObject = ros::Time::now() - omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!omniTimer.waitFor(duration))
 {
 //check if the cube is in his hand or not!
 if (blockBlock || openCVThinksCubeIsHeld)
-	state = DONE_SUCCESS;
+	setState(DONE_SUCCESS);
 }
 else
 {
 //time is up! didnt get the cube. reposition mr. robot now.
-omniTimerStartingTime = ros::Time::now();//reset the timer again
-state = PICKUP_FAILED_BACK_UP;
+omniTimer.restart();//reset the timer again
+setState(PICKUP_FAILED_BACK_UP, true);
 }//end outOfTime
 
 break;
@@ -208,9 +240,8 @@ break;
 case(PICKUP_FAILED_BACK_UP):
 
 duration = 2.25;
-timeDifferenceObject = ros::Time::now() - omniTimerStartingTime;
 
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!omniTimer.waitFor(duration))
 {
 //raise wrist and back up
 result.wristAngle = 0;
@@ -220,19 +251,19 @@ else
 {
 //time is up
 result.cmdVel = 0;
-state = DONE_FAILING;
+setState(DONE_FAILING);
 }
 break;
 
 case (DONE_FAILING):
 //do nothing. wait for mobility to recognize our failure so he can call void resetPickupController();
-state = DONE_FAILING;
+setState(DONE_FAILING);
 break;
 
 case (DONE_SUCCESS):
 result.wristAngle = WRIST_CARRY;
 result.pickedUp = true;//mobility.cpp looks for this flag
-state = DONE_SUCCESS;
+setState(DONE_SUCCESS);
 break;
 
 
@@ -259,17 +290,46 @@ OUTPUTS and changed variables:
 
 
 */
-PickUpResult PickUpController::selectTarget(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message) {
+PickUpResult PickUpController::selectTarget(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message, geometry_msgs::Pose2D currentLocation) {
 
   
     nTargetsSeen = 0;
     nTargetsSeen = message->detections.size();
 result.foundACluster = false;
+result.allClaimed = false;
+result.targetCount = nTargetsSeen;
+selectedTrack = -1;
 
     double closest = std::numeric_limits<double>::max();//Double.MAX_VALUE
-    int target  = 0;
+    int target  = -1;
 if (message->detections.size() > 1)
 	result.foundACluster = true;
+
+    std::vector<TargetTracker::Detection> detections(message->detections.size());
+    std::vector<double> yawErrors(message->detections.size());
+    for (int i = 0; i < message->detections.size(); i++)
+    {
+        geometry_msgs::PoseStamped tagPose = message->detections[i].pose;
+
+        double dist = hypot(tagPose.pose.position.z, tagPose.pose.position.y); //distance from bottom center of chassis ignoring height.
+        //not sure why; a tag closer than 0.195 would give a NaN, so it counts
+        //as right under the camera, as in NestEstimator
+        dist = dist > 0.195 ? sqrt(dist*dist - 0.195*0.195) : 0;
+        double yawError = atan((tagPose.pose.position.x + 0.020)/dist)*1.05; //angle to block from bottom center of chassis on the horizontal.
+        if (dist == 0) yawError = 0;
+
+        //where the cube is, so we can leave it alone if another rover already called it
+        detections[i].x = currentLocation.x + dist*cos(currentLocation.theta - yawError);
+        detections[i].y = currentLocation.y + dist*sin(currentLocation.theta - yawError);
+        detections[i].range = dist;
+        yawErrors[i] = yawError;
+    }
+
+    //every cube goes into the tracker, picked or not, the whole frame at once
+    //so cubes side by side do not end up in the same track
+    if (!detections.empty())
+        tracker.update(&detections[0], detections.size());
+
     for (int i = 0; i < message->detections.size(); i++) //this loop selects the closest visible block to makes goals for it
     {
         geometry_msgs::PoseStamped tagPose = message->detections[i].pose;
@@ -277,14 +337,26 @@ if (message->detections.size() > 1)
 
         if (test < closest)//find the closest block desu
         {
+            if (claims != NULL && claims->isClaimedByOther(detections[i].x, detections[i].y))
+                continue;
+
             target = i;
+            selectedTrack = detections[i].track;
             closest = test;
-            blockDist = hypot(tagPose.pose.position.z, tagPose.pose.position.y); //distance from bottom center of chassis ignoring height.
-            blockDist = sqrt(blockDist*blockDist - 0.195*0.195);//not sure why
-            blockYawError = atan((tagPose.pose.position.x + 0.020)/blockDist)*1.05; //angle to block from bottom center of chassis on the horizontal.
+            blockDist = detections[i].range;
+            blockYawError = yawErrors[i];
+            result.targetX = detections[i].x;
+            result.targetY = detections[i].y;
         }
     }
 
+//every cube in view belongs to another rover
+if (target < 0)
+{
+result.allClaimed = true;
+return result;
+}
+
 //literally how would it be greater than 10 if it comes from the atan function?.... i guess cos of that 1.05 multiplier they got there.....
     if ( blockYawError > 10) blockYawError = 10; //limits block angle error to prevent overspeed from PID.
     if ( blockYawError < - 10) blockYawError = -10; //due to detetionropping out when moveing quickly
@@ -306,7 +378,15 @@ result.blockYawError = blockYawError;
 }
 
 void PickUpController::reset() {
+//the sequence ends in whatever phase it got to
+if (sequenceActive && telemetry != NULL)
+	telemetry->record(telemetryId, state, -1, phaseTimer.elapsed(), state != DONE_SUCCESS);
+sequenceActive = false;
+
     result.pickedUp = false;
+trackedTarget = -1;
+for (int i = 0; i < NUM_STATES; i++)
+	phaseSeconds[i] = 0;
 checkedOnce = false;
 state = FIXING_CAMERA;
 
@@ -330,5 +410,122 @@ blockBlock = false;
 
 }
 
+void PickUpController::setState(int s, bool failed)
+{
+if (s != state)
+{
+	double seconds = phaseTimer.elapsed();
+	phaseSeconds[state] += seconds;
+	if (telemetry != NULL)
+		telemetry->record(telemetryId, state, s, seconds, failed);
+	phaseTimer.restart();
+}
+state = s;
+}
+
+void PickUpController::beginPickUp()
+{
+trackedTarget = selectedTrack;
+phaseTimer.restart();
+sequenceTimer.restart();
+sequenceActive = true;
+}
+
+/*
+one step of the visual servo. the turn is proportional to the yaw error and
+the speed comes from the schedule, cut back while we are still pointed away
+from the cube. hands over to the timed approach once the cube is close.
+*/
+void PickUpController::servo(geometry_msgs::Pose2D currentLocation, const TargetTracker::Estimate& estimate)
+{
+const float maxTurn = 0.4;
+const float headingLimit = 0.35;//no forward speed at all beyond this yaw error
+const float tolerance = 0.030;
+
+float yawError = angle_math::difference(currentLocation.theta, estimate.bearing);
+
+if (estimate.range <= servoHandoffRange && fabs(yawError) <= 2 * tolerance)
+{
+	//close and lined up, the last bit is driven on a timer like before
+	result.cmdVel = 0;
+	result.angleError = 0;
+	distanceToBlockUponFirstSight = estimate.range;
+	setState(APPROACHING_CUBE);
+	omniTimer.restart();
+	return;
+}
+
+//interpolate the gains for this range
+unsigned int row = 0;
+while (row + 1 < servoSchedule.size() && servoSchedule[row + 1].range < estimate.range)
+	row++;
+float yawGain = servoSchedule[row].yawGain;
+float speed = servoSchedule[row].speed;
+if (row + 1 < servoSchedule.size() && estimate.range > servoSchedule[row].range)
+{
+	const ServoGain& low = servoSchedule[row];
+	const ServoGain& high = servoSchedule[row + 1];
+	float t = (estimate.range - low.range) / (high.range - low.range);
+	yawGain = low.yawGain + t * (high.yawGain - low.yawGain);
+	speed = low.speed + t * (high.speed - low.speed);
+}
+
+float turn = yawGain * yawError;
+if (fabs(yawError) < tolerance)
+	turn = 0;
+if (turn > maxTurn) turn = maxTurn;
+if (turn < -maxTurn) turn = -maxTurn;
+
+float heading = 1 - fabs(yawError) / headingLimit;
+if (heading < 0) heading = 0;
+
+//near the handoff range but not lined up: turn on the spot
+if (estimate.range <= servoHandoffRange)
+	heading = 0;
+
+result.angleError = turn;
+result.cmdVel = speed * heading;
+result.fingerAngle = FINGERS_OPEN;
+result.wristAngle = WRIST_DOWN;
+}
+
+void PickUpController::setServoSchedule(const std::vector<double>& schedule, float handoffRange)
+{
+std::vector<ServoGain> rows;
+for (unsigned int i = 0; i + 2 < schedule.size(); i += 3)
+{
+	ServoGain gain;
+	gain.range = schedule[i];
+	gain.yawGain = schedule[i + 1];
+	gain.speed = schedule[i + 2];
+	//rows have to go up in range
+	if (!rows.empty() && gain.range <= rows.back().range)
+		continue;
+	rows.push_back(gain);
+}
+
+//a schedule with no usable rows leaves the old one in place
+if (!rows.empty())
+	servoSchedule = rows;
+servoHandoffRange = handoffRange;
+}
+
+std::string PickUpController::getPhaseLog()
+{
+std::stringstream ss;
+ss << "pickup " << getStateName() << " after " << sequenceTimer.elapsed() << "s:";
+for (int i = 0; i < NUM_STATES; i++)
+{
+	float seconds = phaseSeconds[i];
+	if (i == state)
+		seconds += phaseTimer.elapsed();
+	if (seconds <= 0)
+		continue;
+
+	ss << " " << getStateName(i) << " " << seconds << "s";
+}
+return ss.str();
+}
+
 PickUpController::~PickUpController() {
 }
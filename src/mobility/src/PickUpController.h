@@ -5,6 +5,12 @@
 #include <ros/ros.h>
 #include <geometry_msgs/Pose2D.h>
 #include "Calibration.h"
+#include "Stopwatch.h"
+#include "TargetClaimRegistry.h"
+#include "TargetTracker.h"
+#include "PhaseTelemetry.h"
+#include <string>
+#include <vector>
 
 struct PickUpResult {
   float cmdVel;
@@ -16,6 +22,10 @@ float blockDist;
 float blockYawError;
 float debug;
 bool foundACluster;
+int targetCount;//number of cube tags in the last detection message
+float targetX;//odom position of the selected cube
+float targetY;
+bool allClaimed;//true if every cube seen is claimed by another rover
 };
 
 class PickUpController
@@ -26,7 +36,31 @@ class PickUpController
   ~PickUpController();
 const static float PICKUP_VELOCITY = 0.10;
 
-  PickUpResult selectTarget(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message);
+  PickUpResult selectTarget(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message, geometry_msgs::Pose2D currentLocation);
+
+  //cubes claimed by other rovers in this registry are never selected
+  void setClaimRegistry(TargetClaimRegistry* registry) {claims = registry;}
+
+  //starts a pickup sequence: follow the cube picked by the last selectTarget()
+  //until reset(), and start timing the phases
+  void beginPickUp();
+  //once the tracked cube's estimate is this confident, the camera is not
+  //fixed a second time before approaching
+  void setTrackerConfidence(float confidence) {trackerConfidence = confidence;}
+  //visual servo: with a confident estimate, steer and drive towards the cube
+  //in proportion to where it is instead of turning, stopping and driving
+  //blind. schedule is a flat list of (range, yaw gain, speed) rows sorted by
+  //range; gains in between rows are interpolated. Below handoffRange the
+  //timed approach takes over, because the camera loses the tag up close.
+  void setVisualServo(bool enabled) {visualServo = enabled;}
+  void setServoSchedule(const std::vector<double>& schedule, float handoffRange);
+
+  //how long the current sequence spent in each phase, for the log
+  std::string getPhaseLog();
+  //every phase change from here on is also recorded as controller id
+  void setTelemetry(PhaseTelemetry* telemetry, int id) {this->telemetry = telemetry; telemetryId = id;}
+
+  bool getTargetEstimate(geometry_msgs::Pose2D currentLocation, TargetTracker::Estimate& estimate) {return trackedTarget >= 0 && tracker.estimate(trackedTarget, currentLocation, estimate);}
   PickUpResult pickUpSelectedTarget(geometry_msgs::Pose2D currentLocation, Calibration);
 
   float getDist() {return blockDist;}
@@ -35,20 +69,22 @@ const static float PICKUP_VELOCITY = 0.10;
 void setDistanceToBlockUponFirstSight(float pls,float ok) {distanceToBlockUponFirstSight = pls - 0.00; yawErrorToBlockUponFirstSight = ok;}
 
 int getState() {return state;}
-void setState(int s){state = s;}
+void setState(int s, bool failed = false);
 
 //for PID
 bool checkedOnce;
 
   void reset();
 const static int FIXING_CAMERA=0, APPROACHING_CUBE=1, PICKING_UP_CUBE=2,VERIFYING_PICKUP=3,PICKUP_FAILED_BACK_UP=4,DONE_FAILING=5,
-		DONE_SUCCESS=6,WAIT_BEFORE_RAISING_WRIST=7,WAITING_AND_CHECKING_CAMERA_AGAIN=8;
+		DONE_SUCCESS=6,WAIT_BEFORE_RAISING_WRIST=7,WAITING_AND_CHECKING_CAMERA_AGAIN=8,SERVOING_TO_CUBE=9;
+const static int NUM_STATES = 10;
 volatile int state;
 
-std::string getStateName() {
+std::string getStateName() {return getStateName(getState());}
+std::string getStateName(int s) {
 const std::string stateNames[] = {"FIXING_CAMERA", "APPROACHING_CUBE", "PICKING_UP_CUBE","VERIFYING_PICKUP", "PICKUP_FAILED_BACK_UP","DONE_FAILING",
-		"DONE_SUCCESS","WAIT_BEFORE_RAISING_WRIST","WAITING_AND_CHECKING_CAMERA_AGAIN"};
-return stateNames[getState()];
+		"DONE_SUCCESS","WAIT_BEFORE_RAISING_WRIST","WAITING_AND_CHECKING_CAMERA_AGAIN","SERVOING_TO_CUBE"};
+return stateNames[s];
 }
 
 
@@ -70,7 +106,7 @@ float lastCmdVel;
 float lastAngleError;
 
 
-ros::Time omniTimerStartingTime;
+Stopwatch omniTimer;
 
 private:
   //set true when the target block is less than targetDist so we continue attempting to pick it up rather than
@@ -94,5 +130,31 @@ bool openCVThinksCubeIsHeld;
   PickUpResult result;
 
   float td;
+
+  TargetClaimRegistry* claims;
+
+  //every cube in view, fused over frames
+  TargetTracker tracker;
+  int selectedTrack;
+  int trackedTarget;
+  float trackerConfidence;
+
+  bool visualServo;
+  struct ServoGain {
+    float range;
+    float yawGain;
+    float speed;
+  };
+  std::vector<ServoGain> servoSchedule;
+  float servoHandoffRange;
+  void servo(geometry_msgs::Pose2D currentLocation, const TargetTracker::Estimate& estimate);
+
+  //per phase timing of the current sequence
+  Stopwatch phaseTimer;
+  Stopwatch sequenceTimer;
+  float phaseSeconds[NUM_STATES];
+  PhaseTelemetry* telemetry;
+  int telemetryId;
+  bool sequenceActive;
 };
 #endif // end header define
@@ -0,0 +1,80 @@
+#include "PoseAverage.h"
+#include <cmath>
+
+PoseAverage::PoseAverage(unsigned int windowSize) {
+  setWindowSize(windowSize);
+}
+
+void PoseAverage::setWindowSize(unsigned int windowSize) {
+  if (windowSize < 1) windowSize = 1;
+  window.assign(windowSize, Sample());
+  clear();
+}
+
+void PoseAverage::clear() {
+  next = 0;
+  count = 0;
+  sumX = 0;
+  sumY = 0;
+  sumSin = 0;
+  sumCos = 0;
+}
+
+void PoseAverage::add(const geometry_msgs::Pose2D& pose) {
+  Sample& slot = window[next];
+
+  // the oldest sample drops out of the window once it is full
+  if (count == window.size()) {
+    sumX -= slot.x;
+    sumY -= slot.y;
+    sumSin -= slot.sinTheta;
+    sumCos -= slot.cosTheta;
+  } else {
+    count++;
+  }
+
+  slot.x = pose.x;
+  slot.y = pose.y;
+  slot.sinTheta = sin(pose.theta);
+  slot.cosTheta = cos(pose.theta);
+
+  sumX += slot.x;
+  sumY += slot.y;
+  sumSin += slot.sinTheta;
+  sumCos += slot.cosTheta;
+
+  next++;
+  if (next >= window.size()) {
+    next = 0;
+    // once per lap of the ring is cheap enough to keep the sums exact
+    resum();
+  }
+}
+
+void PoseAverage::resum() {
+  sumX = 0;
+  sumY = 0;
+  sumSin = 0;
+  sumCos = 0;
+  for (unsigned int i = 0; i < count; i++) {
+    sumX += window[i].x;
+    sumY += window[i].y;
+    sumSin += window[i].sinTheta;
+    sumCos += window[i].cosTheta;
+  }
+}
+
+geometry_msgs::Pose2D PoseAverage::getAverage() {
+  geometry_msgs::Pose2D average;
+  if (count == 0) {
+    average.x = 0;
+    average.y = 0;
+    average.theta = 0;
+    return average;
+  }
+
+  average.x = sumX / count;
+  average.y = sumY / count;
+  average.theta = atan2(sumSin, sumCos);
+  return average;
+}
@@ -0,0 +1,53 @@
+#ifndef POSE_AVERAGE_H
+#define POSE_AVERAGE_H
+
+#include <vector>
+#include <geometry_msgs/Pose2D.h>
+
+/**
+ * Running average of the last N poses. Samples live in a ring buffer and the
+ * sums are updated as samples enter and leave the window, so adding a pose
+ * costs the same no matter how large the window is. Headings are averaged on
+ * the unit circle (sin/cos sums) so poses either side of +/-pi do not cancel
+ * each other out.
+ */
+class PoseAverage {
+
+  public:
+
+    PoseAverage(unsigned int windowSize);
+
+    // changing the window size throws away the current history
+    void setWindowSize(unsigned int windowSize);
+    unsigned int getWindowSize() {return window.size();}
+    unsigned int getCount() {return count;}
+
+    void add(const geometry_msgs::Pose2D& pose);
+    void clear();
+
+    // average of the samples seen so far (at most windowSize of them)
+    geometry_msgs::Pose2D getAverage();
+
+  private:
+
+    struct Sample {
+      double x;
+      double y;
+      double sinTheta;
+      double cosTheta;
+    };
+
+    // recompute the sums from scratch so rounding error can not build up
+    void resum();
+
+    std::vector<Sample> window;
+    unsigned int next;  // slot the next sample is written to
+    unsigned int count; // number of valid samples in the window
+
+    double sumX;
+    double sumY;
+    double sumSin;
+    double sumCos;
+};
+
+#endif /* POSE_AVERAGE_H */
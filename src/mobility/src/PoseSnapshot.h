@@ -0,0 +1,80 @@
+#ifndef POSE_SNAPSHOT_H
+#define POSE_SNAPSHOT_H
+
+#include <ros/ros.h>
+#include <geometry_msgs/Pose2D.h>
+#include <boost/atomic.hpp>
+
+/**
+ * A timestamped pose shared between one writer (an odometry callback) and any
+ * number of readers (the mobility timer and the other callbacks) without a
+ * lock. This is a sequence lock: the writer bumps the sequence number to an
+ * odd value, writes, and bumps it to the next even value. A reader that sees
+ * an odd number, or a different number before and after copying, caught the
+ * writer mid-update and simply copies again. The writer never waits.
+ *
+ * The fields themselves are atomics too, loaded and stored relaxed: the
+ * sequence number only tells a reader to throw a torn copy away, and reading
+ * a plain field while it is being written would be a data race however the
+ * copy is used. Relaxed accesses compile to plain moves on the rovers.
+ *
+ * Only one thread may call write() at a time. roscpp guarantees this for a
+ * single subscription unless allow_concurrent_callbacks is set.
+ */
+class PoseSnapshot {
+
+  public:
+
+    PoseSnapshot() : sequence(0), x(0), y(0), theta(0), stampSec(0), stampNsec(0) {}
+
+    void write(const geometry_msgs::Pose2D& pose, const ros::Time& stamp) {
+      unsigned int start = sequence.load(boost::memory_order_relaxed);
+      sequence.store(start + 1, boost::memory_order_relaxed);
+      boost::atomic_thread_fence(boost::memory_order_release);
+
+      x.store(pose.x, boost::memory_order_relaxed);
+      y.store(pose.y, boost::memory_order_relaxed);
+      theta.store(pose.theta, boost::memory_order_relaxed);
+      stampSec.store(stamp.sec, boost::memory_order_relaxed);
+      stampNsec.store(stamp.nsec, boost::memory_order_relaxed);
+
+      sequence.store(start + 2, boost::memory_order_release);
+    }
+
+    // returns the most recent pose; the time it was measured is written to
+    // stamp if one is given
+    geometry_msgs::Pose2D read(ros::Time* stamp = NULL) const {
+      geometry_msgs::Pose2D pose;
+      unsigned int sec, nsec;
+      unsigned int before, after;
+
+      do {
+        before = sequence.load(boost::memory_order_acquire);
+        pose.x = x.load(boost::memory_order_relaxed);
+        pose.y = y.load(boost::memory_order_relaxed);
+        pose.theta = theta.load(boost::memory_order_relaxed);
+        sec = stampSec.load(boost::memory_order_relaxed);
+        nsec = stampNsec.load(boost::memory_order_relaxed);
+        boost::atomic_thread_fence(boost::memory_order_acquire);
+        after = sequence.load(boost::memory_order_relaxed);
+      } while ((before & 1) || before != after);
+
+      if (stamp) {
+        stamp->sec = sec;
+        stamp->nsec = nsec;
+      }
+      return pose;
+    }
+
+  private:
+
+    boost::atomic<unsigned int> sequence;
+
+    boost::atomic<double> x;
+    boost::atomic<double> y;
+    boost::atomic<double> theta;
+    boost::atomic<unsigned int> stampSec;
+    boost::atomic<unsigned int> stampNsec;
+};
+
+#endif /* POSE_SNAPSHOT_H */
@@ -1,29 +1,50 @@
 #include "SearchController.h"
 
-SearchController::SearchController() {
+// the base spiral puts three waypoints on each turn and moves half a meter
+// further out with every waypoint
+// up to eight clusters are remembered, sightings within a meter of each other
+// are the same cluster and a cluster not seen for ten minutes is forgotten
+SearchController::SearchController() : clusters(8, 1.0, 600), baseSpiral(1.5, 0, 3, 11.0) {
   rng = new random_numbers::RandomNumberGenerator();
+  strategy = new RandomWalkStrategy(SearchStrategy::Settings(), rng);
+  coverage = NULL;
+  maxCoverageSkips = 0;
   setState(SETTING_INITIAL_HEADING);
-  comeBackToCluster = false;
 	tryingToFindTheBase = false;	
 	
 }
 
-void SearchController::initTryingToFindBase(float x,float y){
+SearchController::~SearchController() {
+  delete strategy;
+  delete rng;
+}
+
+void SearchController::setStrategy(SearchStrategy* strategy) {
+  if (strategy == NULL) return;
+  delete this->strategy;
+  this->strategy = strategy;
+}
+
+void SearchController::setSearchCenter(float x, float y) {
+  strategy->setCenter(x, y);
+}
 
-originX = x;
-originY = y;
+void SearchController::setCoverage(CoverageGrid* coverage, int maxSkips) {
+  this->coverage = coverage;
+  maxCoverageSkips = maxSkips;
+}
 
+void SearchController::initTryingToFindBase(float x,float y){
 
-spiralAngle = 0;
-spiralLength = 0;
-spiralCounter = 0;
+baseSpiral.setCenter(x, y);
 
 tryingToFindTheBase = true;
 
 }//end void
 
 /**
- * This code implements a basic random walk search.
+ * Picks the next goal: spiral for the base if we lost it, go back to a
+ * cluster we saw, otherwise whatever the search strategy says.
  */
 geometry_msgs::Pose2D SearchController::search(geometry_msgs::Pose2D currentLocation) {
   geometry_msgs::Pose2D goalLocation;
@@ -31,39 +52,27 @@ geometry_msgs::Pose2D SearchController::search(geometry_msgs::Pose2D currentLoca
 
 if (tryingToFindTheBase)
 {
-spiralAngle += (2*3.1415) / (float)numPoints;
-goalLocation.x = originX + spiralLength * cos(spiralAngle);
-goalLocation.y = originY + spiralLength * sin(spiralAngle);
-spiralCounter++;
-spiralLength = spiralCounter * (0.50);
-
-
-return goalLocation;
+return baseSpiral.next(currentLocation);
 }
 
 
-if (comeBackToCluster && !tryingToFindTheBase)
+ClusterQueue::Cluster cluster;
+if (clusters.pop(currentLocation, cluster))
 {
-goalLocation.x = clusterLocation.x;
-goalLocation.y = clusterLocation.y; 
+goalLocation.x = cluster.x;
+goalLocation.y = cluster.y;
 return goalLocation;
 }
 
 
+  goalLocation = strategy->next(currentLocation);
 
-
-
-
-
-float newAngle = rng->gaussian(currentLocation.theta, 0.50);
-
-//select new position!
-goalLocation.x = currentLocation.x + 1.00 * cos(newAngle);
-goalLocation.y = currentLocation.y + 1.00 * sin(newAngle);
-
-
+  // prefer ground nobody has covered yet
+  if (coverage != NULL) {
+    for (int i = 0; i < maxCoverageSkips && coverage->isVisited(goalLocation.x, goalLocation.y); i++) {
+      goalLocation = strategy->next(currentLocation);
+    }
+  }
 
   return goalLocation;
 }
-
-
@@ -3,6 +3,10 @@
 
 #include <geometry_msgs/Pose2D.h>
 #include <random_numbers/random_numbers.h>
+#include "SearchStrategy.h"
+#include "CoverageGrid.h"
+#include "ClusterQueue.h"
+#include "Stopwatch.h"
 
 /**
  * This class implements the search control algorithm for the rovers. The code
@@ -13,13 +17,13 @@ class SearchController {
   public:
 
     SearchController();
+    ~SearchController();
 
 //NAVI refers to the sub-statemachine used for controlling the searchController && 
 const static int SETTING_INITIAL_HEADING = 0, WAITING_FOR_MOMENTUM_BEFORE_MOVING = 1, MOVING_TO_GOAL = 2, REACHED_GOAL = 3, REACHED_GOAL_PAUSE=4, TAKING_A_LOOK=5;
 
 
-ros::Duration timeDifferenceObject;
-ros::Time omniTimerStartingTime;
+Stopwatch omniTimer;
 int state;
 
 std::string getStateName() {
@@ -32,19 +36,24 @@ void setState(int s){state=s;}
 
 void initTryingToFindBase(float x,float y);
 
-geometry_msgs::Pose2D clusterLocation;
-bool comeBackToCluster;
+// clusters of cubes seen but not finished yet; search() goes back to the
+// best one before searching anywhere new
+ClusterQueue clusters;
 
 float lastAngle, accumulatedAngle;
 bool tryingToFindTheBase;
 
-float spiralLength;
-float spiralAngle;
-float originX;
-float originY;
-const static int numPoints = 3;
-int spiralCounter;
 
+    // takes ownership of the strategy; the default is a random walk
+    void setStrategy(SearchStrategy* strategy);
+    SearchStrategy* getStrategy() {return strategy;}
+
+    // anchors the search pattern, normally on the collection zone
+    void setSearchCenter(float x, float y);
+
+    // with a coverage grid, search() asks the strategy again (up to maxSkips
+    // times) when its goal lands on ground the swarm has already covered
+    void setCoverage(CoverageGrid* coverage, int maxSkips);
 
     // performs search pattern
     geometry_msgs::Pose2D search(geometry_msgs::Pose2D currentLocation);
@@ -52,6 +61,14 @@ int spiralCounter;
   private:
 
     random_numbers::RandomNumberGenerator* rng;
+
+    SearchStrategy* strategy;
+
+    CoverageGrid* coverage;
+    int maxCoverageSkips;
+
+    // spiral out from where we last thought the base was
+    SpiralStrategy baseSpiral;
 };
 
 #endif /* SEARCH_CONTROLLER */
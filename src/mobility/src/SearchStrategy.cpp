@@ -0,0 +1,239 @@
+#include "SearchStrategy.h"
+#include <cmath>
+
+namespace {
+
+const int headingTableSize = 720; // half degree resolution
+double headingCos[headingTableSize];
+double headingSin[headingTableSize];
+
+// filled in once, before main() runs
+struct HeadingTableInitializer {
+  HeadingTableInitializer() {
+    for (int i = 0; i < headingTableSize; i++) {
+      double angle = 2 * M_PI * i / headingTableSize;
+      headingCos[i] = cos(angle);
+      headingSin[i] = sin(angle);
+    }
+  }
+} headingTableInitializer;
+
+int headingIndex(double angle) {
+  int i = (int)floor(angle * headingTableSize / (2 * M_PI) + 0.5) % headingTableSize;
+  if (i < 0) i += headingTableSize;
+  return i;
+}
+
+double clamp(double value, double low, double high) {
+  if (value < low) return low;
+  if (value > high) return high;
+  return value;
+}
+
+} // namespace
+
+SearchStrategy::Settings::Settings() {
+  spacing = 0.5;
+  stepLength = 1.0;
+  arenaRadius = 7.5;
+  minFlight = 0.5;
+  maxFlight = 6.0;
+  levyMu = 2.0;
+  roverIndex = 0;
+  roverCount = 1;
+}
+
+SearchStrategy* SearchStrategy::create(const std::string& name, const Settings& settings, random_numbers::RandomNumberGenerator* rng) {
+  if (name == "random_walk") return new RandomWalkStrategy(settings, rng);
+  if (name == "spiral") return new SpiralStrategy(settings.spacing, settings.stepLength, 8, settings.arenaRadius);
+  if (name == "lawnmower") return new LawnmowerStrategy(settings);
+  if (name == "levy") return new LevyFlightStrategy(settings, rng);
+  if (name == "sector_spiral") return new SectorSpiralStrategy(settings);
+  return NULL;
+}
+
+SearchStrategy::SearchStrategy() {
+  centerX = 0;
+  centerY = 0;
+}
+
+void SearchStrategy::setCenter(float x, float y) {
+  centerX = x;
+  centerY = y;
+}
+
+/*
+ * Waypoint strategies
+ */
+
+WaypointStrategy::WaypointStrategy() {
+  index = 0;
+  joined = false;
+}
+
+void WaypointStrategy::addWaypoint(double x, double y) {
+  geometry_msgs::Pose2D point;
+  point.x = x;
+  point.y = y;
+  point.theta = 0;
+  waypoints.push_back(point);
+}
+
+void WaypointStrategy::setCenter(float x, float y) {
+  SearchStrategy::setCenter(x, y);
+  joined = false;
+}
+
+geometry_msgs::Pose2D WaypointStrategy::next(const geometry_msgs::Pose2D& currentLocation) {
+  if (waypoints.empty()) return currentLocation;
+
+  if (!joined) {
+    // start from the waypoint nearest to where we are now
+    double best = -1;
+    for (unsigned int i = 0; i < waypoints.size(); i++) {
+      double dx = centerX + waypoints[i].x - currentLocation.x;
+      double dy = centerY + waypoints[i].y - currentLocation.y;
+      double distance = dx*dx + dy*dy;
+      if (best < 0 || distance < best) {
+        best = distance;
+        index = i;
+      }
+    }
+    joined = true;
+  }
+
+  geometry_msgs::Pose2D goalLocation;
+  goalLocation.x = centerX + waypoints[index].x;
+  goalLocation.y = centerY + waypoints[index].y;
+  goalLocation.theta = 0;
+
+  // start over once the whole pattern has been driven
+  index++;
+  if (index >= waypoints.size()) index = 0;
+
+  return goalLocation;
+}
+
+/*
+ * Random walk
+ */
+
+RandomWalkStrategy::RandomWalkStrategy(const Settings& settings, random_numbers::RandomNumberGenerator* rng) {
+  this->rng = rng;
+  stepLength = settings.stepLength;
+}
+
+geometry_msgs::Pose2D RandomWalkStrategy::next(const geometry_msgs::Pose2D& currentLocation) {
+  int heading = headingIndex(rng->gaussian(currentLocation.theta, 0.50));
+
+  geometry_msgs::Pose2D goalLocation;
+  goalLocation.x = currentLocation.x + stepLength * headingCos[heading];
+  goalLocation.y = currentLocation.y + stepLength * headingSin[heading];
+  goalLocation.theta = 0;
+  return goalLocation;
+}
+
+/*
+ * Archimedean spiral: r = armSpacing * angle / 2pi. Waypoints are placed every
+ * stepLength meters of arc but never fewer than maxPointsPerTurn per turn. A
+ * stepLength of 0 gives exactly maxPointsPerTurn points on every turn.
+ */
+
+SpiralStrategy::SpiralStrategy(double armSpacing, double stepLength, int maxPointsPerTurn, double maxRadius) {
+  if (armSpacing <= 0) armSpacing = 0.5;
+  if (maxPointsPerTurn < 3) maxPointsPerTurn = 3;
+
+  double maxStep = 2 * M_PI / maxPointsPerTurn;
+  double angle = 0;
+  double radius = 0;
+
+  while (radius <= maxRadius) {
+    addWaypoint(radius * cos(angle), radius * sin(angle));
+
+    double step = maxStep;
+    if (radius > 0 && stepLength > 0 && stepLength / radius < step) step = stepLength / radius;
+    angle += step;
+    radius = armSpacing * angle / (2 * M_PI);
+  }
+}
+
+/*
+ * Lawnmower
+ */
+
+LawnmowerStrategy::LawnmowerStrategy(const Settings& settings) {
+  double spacing = settings.spacing > 0 ? settings.spacing : 0.5;
+  double edge = settings.arenaRadius;
+  int count = settings.roverCount > 0 ? settings.roverCount : 1;
+  int lanes = (int)floor(2 * edge / spacing) + 1;
+  bool leftToRight = true;
+
+  for (int lane = 0; lane < lanes; lane++) {
+    if (lane % count != settings.roverIndex % count) continue;
+
+    double y = -edge + lane * spacing;
+    if (leftToRight) {
+      addWaypoint(-edge, y);
+      addWaypoint(edge, y);
+    } else {
+      addWaypoint(edge, y);
+      addWaypoint(-edge, y);
+    }
+    leftToRight = !leftToRight;
+  }
+}
+
+/*
+ * Sector spiral: concentric arcs across this rover's wedge, alternating
+ * direction so each arc starts where the last one ended.
+ */
+
+SectorSpiralStrategy::SectorSpiralStrategy(const Settings& settings) {
+  double spacing = settings.spacing > 0 ? settings.spacing : 0.5;
+  double stepLength = settings.stepLength > 0 ? settings.stepLength : 1.0;
+  int count = settings.roverCount > 0 ? settings.roverCount : 1;
+  double width = 2 * M_PI / count;
+  double start = width * (settings.roverIndex % count);
+  bool counterClockwise = true;
+
+  for (double radius = spacing; radius <= settings.arenaRadius; radius += spacing) {
+    int steps = (int)ceil(width * radius / stepLength);
+    if (steps < 1) steps = 1;
+
+    for (int i = 0; i <= steps; i++) {
+      double fraction = (double)i / steps;
+      double angle = counterClockwise ? start + fraction * width : start + width - fraction * width;
+      addWaypoint(radius * cos(angle), radius * sin(angle));
+    }
+    counterClockwise = !counterClockwise;
+  }
+}
+
+/*
+ * Levy flight: step lengths follow a Pareto tail, P(l) ~ l^-mu, drawn by
+ * inverting the CDF of a uniform sample.
+ */
+
+LevyFlightStrategy::LevyFlightStrategy(const Settings& settings, random_numbers::RandomNumberGenerator* rng) {
+  this->rng = rng;
+  minFlight = settings.minFlight;
+  maxFlight = settings.maxFlight;
+  double mu = settings.levyMu > 1.05 ? settings.levyMu : 1.05;
+  exponent = -1.0 / (mu - 1.0);
+  arenaRadius = settings.arenaRadius;
+}
+
+geometry_msgs::Pose2D LevyFlightStrategy::next(const geometry_msgs::Pose2D& currentLocation) {
+  double u = rng->uniformReal(1e-6, 1.0);
+  double length = minFlight * pow(u, exponent);
+  if (length > maxFlight) length = maxFlight;
+
+  int heading = rng->uniformInteger(0, headingTableSize - 1);
+
+  // stay inside the arena
+  geometry_msgs::Pose2D goalLocation;
+  goalLocation.x = clamp(currentLocation.x + length * headingCos[heading], centerX - arenaRadius, centerX + arenaRadius);
+  goalLocation.y = clamp(currentLocation.y + length * headingSin[heading], centerY - arenaRadius, centerY + arenaRadius);
+  goalLocation.theta = 0;
+  return goalLocation;
+}
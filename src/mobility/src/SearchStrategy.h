@@ -0,0 +1,139 @@
+#ifndef SEARCH_STRATEGY_H
+#define SEARCH_STRATEGY_H
+
+#include <string>
+#include <vector>
+#include <geometry_msgs/Pose2D.h>
+#include <random_numbers/random_numbers.h>
+
+/**
+ * A search strategy hands the SearchController its next waypoint. Strategies
+ * that follow a fixed path build the whole path once, relative to the search
+ * center, and afterwards only look points up. The stochastic ones draw their
+ * headings from a precomputed unit vector table so no trig runs per waypoint.
+ */
+class SearchStrategy {
+
+  public:
+
+    // everything a strategy may need to lay out its pattern
+    struct Settings {
+      Settings();
+      double spacing;     // meters between spiral arms / mower lanes
+      double stepLength;  // meters between consecutive waypoints on a path
+      double arenaRadius; // half width of the arena, measured from the nest
+      double minFlight;   // shortest Levy flight step in meters
+      double maxFlight;   // longest Levy flight step in meters
+      double levyMu;      // Levy exponent, 1 < mu <= 3
+      int roverIndex;     // this rover's slot, for strategies that split the arena
+      int roverCount;
+    };
+
+    // returns a new strategy or NULL if the name is not known. Known names are
+    // random_walk, spiral, lawnmower, levy and sector_spiral.
+    static SearchStrategy* create(const std::string& name, const Settings& settings, random_numbers::RandomNumberGenerator* rng);
+
+    virtual ~SearchStrategy() {}
+
+    virtual std::string getName() = 0;
+
+    // (re)anchors the pattern, normally on the collection zone
+    virtual void setCenter(float x, float y);
+
+    virtual geometry_msgs::Pose2D next(const geometry_msgs::Pose2D& currentLocation) = 0;
+
+  protected:
+
+    SearchStrategy();
+
+    float centerX;
+    float centerY;
+};
+
+/**
+ * Base for strategies that replay a path computed once up front. On the first
+ * request after the center is set the rover joins the path at the waypoint
+ * closest to it instead of driving back to the start.
+ */
+class WaypointStrategy : public SearchStrategy {
+
+  public:
+
+    void setCenter(float x, float y);
+    geometry_msgs::Pose2D next(const geometry_msgs::Pose2D& currentLocation);
+
+    unsigned int getNumWaypoints() {return waypoints.size();}
+
+  protected:
+
+    WaypointStrategy();
+
+    // points relative to the center
+    std::vector<geometry_msgs::Pose2D> waypoints;
+    unsigned int index;
+    bool joined;
+
+    void addWaypoint(double x, double y);
+};
+
+class RandomWalkStrategy : public SearchStrategy {
+
+  public:
+
+    RandomWalkStrategy(const Settings& settings, random_numbers::RandomNumberGenerator* rng);
+    std::string getName() {return "random_walk";}
+    geometry_msgs::Pose2D next(const geometry_msgs::Pose2D& currentLocation);
+
+  private:
+
+    random_numbers::RandomNumberGenerator* rng;
+    double stepLength;
+};
+
+// Archimedean spiral around the center with evenly spaced arms
+class SpiralStrategy : public WaypointStrategy {
+
+  public:
+
+    SpiralStrategy(double armSpacing, double stepLength, int maxPointsPerTurn, double maxRadius);
+    std::string getName() {return "spiral";}
+};
+
+// back and forth lanes across the square arena; with several rovers each one
+// takes every roverCount-th lane
+class LawnmowerStrategy : public WaypointStrategy {
+
+  public:
+
+    LawnmowerStrategy(const Settings& settings);
+    std::string getName() {return "lawnmower";}
+};
+
+// spiral arcs that only sweep this rover's wedge of the arena
+class SectorSpiralStrategy : public WaypointStrategy {
+
+  public:
+
+    SectorSpiralStrategy(const Settings& settings);
+    std::string getName() {return "sector_spiral";}
+};
+
+// uniformly random headings with power law distributed step lengths
+class LevyFlightStrategy : public SearchStrategy {
+
+  public:
+
+    LevyFlightStrategy(const Settings& settings, random_numbers::RandomNumberGenerator* rng);
+    std::string getName() {return "levy";}
+    geometry_msgs::Pose2D next(const geometry_msgs::Pose2D& currentLocation);
+
+  private:
+
+    random_numbers::RandomNumberGenerator* rng;
+    double minFlight;
+    double maxFlight;
+    double exponent; // -1/(mu - 1), applied to a uniform sample
+    double arenaRadius;
+};
+
+#endif /* SEARCH_STRATEGY_H */
@@ -0,0 +1,48 @@
+#include "SonarHistogram.h"
+#include "Stopwatch.h"
+#include "AngleMath.h"
+
+SonarHistogram::SonarHistogram(int threshold, float maxAge, float maxDeviation) {
+  this->threshold = threshold;
+  this->maxAge = maxAge;
+  this->maxDeviation = maxDeviation;
+  received = 0;
+}
+
+void SonarHistogram::update(const std::vector<uint8_t>& sectors) {
+  this->sectors = sectors;
+  received = Stopwatch::now();
+}
+
+bool SonarHistogram::isFree(int sector) {
+  int count = sectors.size();
+  for (int i = sector - 1; i <= sector + 1; i++) {
+    if (sectors[(i + count) % count] >= threshold) return false;
+  }
+  return true;
+}
+
+bool SonarHistogram::steer(float bearing, float& direction) {
+  if (sectors.empty() || Stopwatch::now() - received > maxAge) return false;
+
+  int count = sectors.size();
+  double sectorWidth = angle_math::twoPi / count;
+  int goal = (int)(angle_math::wrapPositive(bearing + sectorWidth / 2) / sectorWidth) % count;
+  if (isFree(goal)) {
+    direction = bearing;
+    return true;
+  }
+
+  // widen the search a sector at a time, trying the side the goal leans to first
+  double offset = angle_math::difference(bearing, goal * sectorWidth);
+  int first = offset >= 0 ? 1 : -1;
+  for (int step = 1; step * sectorWidth <= maxDeviation && step <= count / 2; step++) {
+    int sector = (goal + first * step + count) % count;
+    if (!isFree(sector)) sector = (goal - first * step + count) % count;
+    if (isFree(sector)) {
+      direction = angle_math::wrap(sector * sectorWidth);
+      return true;
+    }
+  }
+  return false;
+}
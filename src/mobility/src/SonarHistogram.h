@@ -0,0 +1,43 @@
+#ifndef SONAR_HISTOGRAM_H
+#define SONAR_HISTOGRAM_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * The free direction histogram the obstacle node publishes on
+ * <rover>/sonarHistogram: sector 0 straight ahead, counting counterclockwise,
+ * each 0-255 for how much is in that direction.
+ *
+ * steer() picks where to drive the way a vector field histogram does: a
+ * direction is free when its sector and the sectors on either side of it are
+ * under threshold, so the gap is wide enough for the rover, and of the free
+ * directions the one closest to where we want to go wins.
+ */
+class SonarHistogram {
+
+  public:
+
+    SonarHistogram(int threshold, float maxAge, float maxDeviation);
+
+    void update(const std::vector<uint8_t>& sectors);
+
+    // direction (radians left of straight ahead) to drive in to get towards
+    // bearing, which is bearing itself when that is free. False when the
+    // histogram is older than maxAge or nothing within maxDeviation of
+    // bearing is free.
+    bool steer(float bearing, float& direction);
+
+  private:
+
+    bool isFree(int sector);
+
+    std::vector<uint8_t> sectors;
+    double received; // Stopwatch::now()
+
+    int threshold;
+    float maxAge;
+    float maxDeviation;
+};
+
+#endif /* SONAR_HISTOGRAM_H */
@@ -0,0 +1,27 @@
+#include "Stopwatch.h"
+#include <ros/ros.h>
+#include <time.h>
+
+namespace {
+Stopwatch::WakeupHandler wakeupHandler = NULL;
+}
+
+double Stopwatch::now() {
+  if (ros::Time::isSimTime()) return ros::Time::now().toSec();
+
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1000000000.0;
+}
+
+bool Stopwatch::waitFor(double seconds) const {
+  double remaining = seconds - elapsed();
+  if (remaining <= 0) return true;
+
+  if (wakeupHandler) wakeupHandler(remaining);
+  return false;
+}
+
+void Stopwatch::setWakeupHandler(WakeupHandler handler) {
+  wakeupHandler = handler;
+}
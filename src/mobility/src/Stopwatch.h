@@ -0,0 +1,46 @@
+#ifndef STOPWATCH_H
+#define STOPWATCH_H
+
+/**
+ * Measures the time since it was last restarted. On a real rover it reads the
+ * monotonic clock, so clock steps from NTP or the GPS can not stretch or cut a
+ * wait short. Under simulated time (use_sim_time) it reads ros::Time instead,
+ * so waits speed up and slow down with Gazebo.
+ *
+ * A stopwatch that was never restarted counts from the clock's zero, the same
+ * as comparing against an unset ros::Time did.
+ *
+ * waitFor() is for state machine code that polls a wait: while the time is
+ * not up it asks the wakeup handler, if one is set, to run the caller again
+ * when it will be, so the caller need not poll at a fixed rate.
+ */
+class Stopwatch {
+
+  public:
+
+    typedef void (*WakeupHandler)(double seconds);
+
+    Stopwatch() : start(0) {}
+
+    void restart() {start = now();}
+
+    double elapsed() const {return now() - start;}
+
+    bool hasElapsed(double seconds) const {return elapsed() >= seconds;}
+
+    // true once seconds have passed since the restart, otherwise schedules a
+    // wakeup for when they will have
+    bool waitFor(double seconds) const;
+
+    // seconds on the clock stopwatches use
+    static double now();
+
+    // handler(seconds) should run the waiting code again after seconds
+    static void setWakeupHandler(WakeupHandler handler);
+
+  private:
+
+    double start;
+};
+
+#endif /* STOPWATCH_H */
@@ -0,0 +1,245 @@
+#include "TargetClaimRegistry.h"
+#include <cmath>
+#include <cstring>
+
+TargetClaimRegistry::TargetClaimRegistry(ArenaFrame& frame, std::string roverName, double leaseSeconds, double matchRadius, double maxMatchRadius) : frame(frame) {
+  strncpy(name, roverName.c_str(), nameLength - 1);
+  name[nameLength - 1] = '\0';
+  this->leaseSeconds = leaseSeconds;
+  this->matchRadius = matchRadius > 0 ? matchRadius : 0.3;
+  this->maxMatchRadius = maxMatchRadius > this->matchRadius ? maxMatchRadius : this->matchRadius;
+
+  for (int i = 0; i < tableSize; i++) {
+    table[i].state = EMPTY;
+  }
+  largestError = 0;
+  ownClaim = -1;
+  claimLost = false;
+}
+
+void TargetClaimRegistry::advertise(ros::NodeHandle& nodeHandle) {
+  claimPublish = nodeHandle.advertise<std_msgs::Float64MultiArray>("/targetClaims", 10);
+  claimSubscriber = nodeHandle.subscribe("/targetClaims", 20, &TargetClaimRegistry::claimHandler, this);
+}
+
+bool TargetClaimRegistry::wins(double timeA, const char* nameA, double timeB, const char* nameB) {
+  if (timeA != timeB) return timeA < timeB;
+  return strcmp(nameA, nameB) < 0;
+}
+
+int32_t TargetClaimRegistry::cellKey(double x, double y) {
+  int32_t column = (int32_t)floor(x / matchRadius);
+  int32_t row = (int32_t)floor(y / matchRadius);
+  return ((column & 0xFFFF) << 16) | (row & 0xFFFF);
+}
+
+double TargetClaimRegistry::tolerance(double errorA, double errorB) {
+  double radius = matchRadius + 2 * sqrt(errorA * errorA + errorB * errorB);
+  return radius < maxMatchRadius ? radius : maxMatchRadius;
+}
+
+static int hashCell(int32_t cell, int size) {
+  return (int)(((uint32_t)cell * 2654435761u) >> 16) & (size - 1);
+}
+
+// finds a live claim in cell near (x, y) whose owner is not owner
+int TargetClaimRegistry::findSlot(int32_t cell, double x, double y, double error, const char* owner, double now) {
+  int slot = hashCell(cell, tableSize);
+
+  for (int probe = 0; probe < tableSize; probe++, slot = (slot + 1) & (tableSize - 1)) {
+    Claim& claim = table[slot];
+    if (claim.state == EMPTY) return -1;
+    if (claim.state != USED || claim.cell != cell || claim.expiry < now) continue;
+    if (strcmp(claim.owner, owner) == 0) continue;
+    if (hypot(claim.x - x, claim.y - y) > tolerance(claim.error, error)) continue;
+    return slot;
+  }
+  return -1;
+}
+
+int TargetClaimRegistry::findOwner(const char* owner, double now) {
+  for (int slot = 0; slot < tableSize; slot++) {
+    Claim& claim = table[slot];
+    if (claim.state == USED && claim.expiry >= now && strcmp(claim.owner, owner) == 0) return slot;
+  }
+  return -1;
+}
+
+// the strongest claim by another rover on a cube at arena position (x, y)
+int TargetClaimRegistry::findConflict(double x, double y, double error, const char* owner, double now) {
+  int column = (int)floor(x / matchRadius);
+  int row = (int)floor(y / matchRadius);
+  double radius = tolerance(error, largestError);
+  int reach = (int)ceil(radius / matchRadius);
+  int best = -1;
+
+  for (int dx = -reach; dx <= reach; dx++) {
+    for (int dy = -reach; dy <= reach; dy++) {
+      // skip the corners of the square that are out of reach
+      double left = (column + dx) * matchRadius;
+      double bottom = (row + dy) * matchRadius;
+      double nearX = x < left ? left : (x > left + matchRadius ? left + matchRadius : x);
+      double nearY = y < bottom ? bottom : (y > bottom + matchRadius ? bottom + matchRadius : y);
+      if (hypot(nearX - x, nearY - y) > radius) continue;
+
+      int32_t cell = (((column + dx) & 0xFFFF) << 16) | ((row + dy) & 0xFFFF);
+      int slot = findSlot(cell, x, y, error, owner, now);
+      if (slot < 0) continue;
+      if (best < 0 || wins(table[slot].claimTime, table[slot].owner, table[best].claimTime, table[best].owner)) best = slot;
+    }
+  }
+  return best;
+}
+
+int TargetClaimRegistry::insert(double x, double y, double error, const char* owner, double claimTime, double expiry, double now) {
+  int32_t cell = cellKey(x, y);
+  int slot = hashCell(cell, tableSize);
+
+  // expired claims are as good as free
+  for (int probe = 0; probe < tableSize; probe++, slot = (slot + 1) & (tableSize - 1)) {
+    Claim& claim = table[slot];
+    if (claim.state == USED && (claim.expiry >= now || slot == ownClaim)) continue;
+
+    claim.state = USED;
+    claim.cell = cell;
+    claim.x = x;
+    claim.y = y;
+    claim.error = error;
+    claim.claimTime = claimTime;
+    claim.expiry = expiry;
+    strncpy(claim.owner, owner, nameLength - 1);
+    claim.owner[nameLength - 1] = '\0';
+    return slot;
+  }
+  return -1;
+}
+
+void TargetClaimRegistry::erase(int slot) {
+  table[slot].state = DELETED;
+  if (slot == ownClaim) ownClaim = -1;
+
+  // a run of tombstones that ends in an empty slot ends no probe sequence
+  // early, so it can be emptied and lookups stop there
+  if (table[(slot + 1) & (tableSize - 1)].state != EMPTY) return;
+  for (int i = 0; i < tableSize && table[slot].state == DELETED; i++, slot = (slot - 1) & (tableSize - 1)) {
+    table[slot].state = EMPTY;
+  }
+}
+
+void TargetClaimRegistry::refreshLargestError(double now) {
+  largestError = 0;
+  for (int slot = 0; slot < tableSize; slot++) {
+    Claim& claim = table[slot];
+    if (claim.state != USED || claim.expiry < now || slot == ownClaim) continue;
+    if (claim.error > largestError) largestError = claim.error;
+  }
+}
+
+void TargetClaimRegistry::publish(int slot, bool claiming) {
+  std_msgs::Float64MultiArray message;
+  std_msgs::MultiArrayDimension sender;
+  sender.label = name;
+  sender.size = 6;
+  sender.stride = 1;
+  message.layout.dim.push_back(sender);
+
+  message.data.push_back(claiming ? 1 : 0);
+  message.data.push_back(table[slot].x);
+  message.data.push_back(table[slot].y);
+  message.data.push_back(table[slot].claimTime);
+  message.data.push_back(leaseSeconds);
+  message.data.push_back(table[slot].error);
+  claimPublish.publish(message);
+}
+
+bool TargetClaimRegistry::claim(double x, double y) {
+  // without the shared frame there is nothing to coordinate on
+  if (!frame.isValid()) return true;
+
+  double now = ros::Time::now().toSec();
+  double arenaX, arenaY;
+  frame.toArena(x, y, arenaX, arenaY);
+  double error = frame.getError(arenaX, arenaY);
+
+  // renewing keeps the original claim time, that is what decides conflicts
+  double claimTime = now;
+  bool renewing = ownClaim >= 0 && hypot(table[ownClaim].x - arenaX, table[ownClaim].y - arenaY) <= tolerance(table[ownClaim].error, error);
+  if (renewing) claimTime = table[ownClaim].claimTime;
+
+  int conflict = findConflict(arenaX, arenaY, error, name, now);
+  if (conflict >= 0 && wins(table[conflict].claimTime, table[conflict].owner, claimTime, name)) {
+    return false;
+  }
+
+  if (renewing) {
+    table[ownClaim].expiry = now + leaseSeconds;
+    table[ownClaim].error = error;
+  } else {
+    // a rover only works on one cube at a time
+    if (ownClaim >= 0) release();
+    ownClaim = insert(arenaX, arenaY, error, name, claimTime, now + leaseSeconds, now);
+    if (ownClaim < 0) return true; // table full of live claims; go anyway
+  }
+
+  publish(ownClaim, true);
+  return true;
+}
+
+bool TargetClaimRegistry::isClaimedByOther(double x, double y) {
+  if (!frame.isValid()) return false;
+
+  double arenaX, arenaY;
+  frame.toArena(x, y, arenaX, arenaY);
+  double error = frame.getError(arenaX, arenaY);
+  int conflict = findConflict(arenaX, arenaY, error, name, ros::Time::now().toSec());
+  if (conflict < 0) return false;
+
+  // our own earlier claim on the same cube still stands
+  if (ownClaim >= 0 && hypot(table[ownClaim].x - arenaX, table[ownClaim].y - arenaY) <= tolerance(table[ownClaim].error, error)) {
+    return !wins(table[ownClaim].claimTime, name, table[conflict].claimTime, table[conflict].owner);
+  }
+  return true;
+}
+
+void TargetClaimRegistry::renew() {
+  if (ownClaim < 0) return;
+  table[ownClaim].expiry = ros::Time::now().toSec() + leaseSeconds;
+  publish(ownClaim, true);
+}
+
+void TargetClaimRegistry::release() {
+  claimLost = false;
+  if (ownClaim < 0) return;
+
+  publish(ownClaim, false);
+  erase(ownClaim);
+}
+
+void TargetClaimRegistry::claimHandler(const std_msgs::Float64MultiArray::ConstPtr& message) {
+  if (message->layout.dim.empty() || message->data.size() < 5) return;
+
+  const std::string& sender = message->layout.dim[0].label;
+  if (sender == name) return;
+
+  bool claiming = message->data[0] != 0;
+  double x = message->data[1];
+  double y = message->data[2];
+  double claimTime = message->data[3];
+  double now = ros::Time::now().toSec();
+  double expiry = now + message->data[4];
+  double error = message->data.size() >= 6 ? message->data[5] : 0;
+
+  // the sender's one claim replaces whatever it held before, which may be
+  // filed under another cell by now
+  int existing = findOwner(sender.c_str(), now);
+  if (existing >= 0) erase(existing);
+  if (claiming) insert(x, y, error, sender.c_str(), claimTime, expiry, now);
+  refreshLargestError(now);
+  if (!claiming) return;
+
+  // did they get to our cube first?
+  if (ownClaim >= 0 && hypot(table[ownClaim].x - x, table[ownClaim].y - y) <= tolerance(table[ownClaim].error, error)
+      && wins(claimTime, sender.c_str(), table[ownClaim].claimTime, name)) {
+    claimLost = true;
+  }
+}
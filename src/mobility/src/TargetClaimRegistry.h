@@ -0,0 +1,110 @@
+#ifndef TARGET_CLAIM_REGISTRY_H
+#define TARGET_CLAIM_REGISTRY_H
+
+#include <string>
+#include <stdint.h>
+#include <ros/ros.h>
+#include <std_msgs/Float64MultiArray.h>
+#include "ArenaFrame.h"
+
+/**
+ * Keeps two rovers from going after the same cube. Before a rover commits to a
+ * cube it claims the cube's position on the shared /targetClaims topic. A claim
+ * is a lease: the holder renews it while it works on the cube and releases it
+ * when done, and a claim that is not renewed simply expires. If two rovers
+ * claim the same cube the earlier claim wins (ties go to the smaller name) and
+ * the loser backs off.
+ *
+ * Each rover places cubes in its own version of the arena frame, and two
+ * versions can be apart by more than a cube. So every claim carries the
+ * claimer's frame error (ArenaFrame::getError), and two positions are the same
+ * cube when they are within matchRadius plus twice the combined error of the
+ * two rovers, up to maxMatchRadius.
+ *
+ * Claims are stored in a fixed size open addressing hash table keyed on the
+ * arena frame cell of the cube, so lookups never allocate. A cube is matched
+ * against the claims in the cells that can hold a match: those within the
+ * tolerance for its error and the largest error among the other rovers'
+ * claims, which is the base matchRadius while the frames agree. A rover holds
+ * at most one claim, so another rover's claim is found again by its name: as
+ * the frames are re-anchored the same cube's position drifts, and can cross
+ * into another cell between renewals.
+ *
+ * Message layout (Float64MultiArray, sender name in layout.dim[0].label):
+ *   [type (1 claim, 0 release), arena x, arena y, claim time, lease seconds, error]
+ */
+class TargetClaimRegistry {
+
+  public:
+
+    TargetClaimRegistry(ArenaFrame& frame, std::string roverName, double leaseSeconds, double matchRadius, double maxMatchRadius);
+
+    void advertise(ros::NodeHandle& nodeHandle);
+
+    // claims the cube at odom position (x, y); false if another rover holds an
+    // earlier claim on it. Claiming again renews our claim.
+    bool claim(double x, double y);
+
+    bool isClaimedByOther(double x, double y);
+
+    // renews our current claim, call about once a second while holding one
+    void renew();
+    void release();
+
+    bool holdsClaim() {return ownClaim >= 0;}
+
+    // set when another rover turned out to have claimed our cube first;
+    // cleared by release()
+    bool lostClaim() {return claimLost;}
+
+  private:
+
+    static const int tableSize = 64; // power of two
+    static const int nameLength = 32;
+
+    enum SlotState {EMPTY, USED, DELETED};
+
+    struct Claim {
+      SlotState state;
+      int32_t cell;
+      double x;
+      double y;
+      double error; // the claimer's frame error at (x, y)
+      double claimTime;
+      double expiry;
+      char owner[nameLength];
+    };
+
+    void claimHandler(const std_msgs::Float64MultiArray::ConstPtr& message);
+    void publish(int slot, bool claiming);
+
+    int32_t cellKey(double x, double y);
+    // how far apart positions placed with these frame errors can be and still be one cube
+    double tolerance(double errorA, double errorB);
+    int findSlot(int32_t cell, double x, double y, double error, const char* owner, double now);
+    // the live claim held by owner, wherever it is
+    int findOwner(const char* owner, double now);
+    int findConflict(double x, double y, double error, const char* owner, double now);
+    int insert(double x, double y, double error, const char* owner, double claimTime, double expiry, double now);
+    void erase(int slot);
+    void refreshLargestError(double now);
+
+    // true if a claim made at timeA by nameA beats one made at timeB by nameB
+    static bool wins(double timeA, const char* nameA, double timeB, const char* nameB);
+
+    ArenaFrame& frame;
+    char name[nameLength];
+    double leaseSeconds;
+    double matchRadius;
+    double maxMatchRadius;
+
+    Claim table[tableSize];
+    double largestError; // of the other rovers' live claims
+    int ownClaim;
+    bool claimLost;
+
+    ros::Publisher claimPublish;
+    ros::Subscriber claimSubscriber;
+};
+
+#endif /* TARGET_CLAIM_REGISTRY_H */
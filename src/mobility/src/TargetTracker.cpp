@@ -0,0 +1,137 @@
+#include "TargetTracker.h"
+#include "Stopwatch.h"
+#include <cmath>
+
+namespace {
+
+// detection noise: a couple of centimeters, plus a tenth of the range
+const float sigmaBase = 0.02;
+const float sigmaPerMeter = 0.10;
+
+// odometry drift while a cube is tracked, square meters per second
+const float driftPerSecond = 0.0004;
+
+} // namespace
+
+TargetTracker::TargetTracker(float gate, float maxAge, float sigmaMax) {
+  this->gate = gate;
+  this->maxAge = maxAge;
+  this->sigmaMax = sigmaMax > 0 ? sigmaMax : 0.1;
+  count = 0;
+  nextId = 0;
+}
+
+void TargetTracker::clear() {
+  count = 0;
+}
+
+void TargetTracker::predict(Track& track, double now) {
+  double dt = now - track.lastSeen;
+  if (dt > 0) track.variance += driftPerSecond * dt;
+  track.lastSeen = now;
+}
+
+float TargetTracker::confidence(const Track& track) {
+  float c = 1 - sqrt(track.variance) / sigmaMax;
+  return c > 0 ? c : 0;
+}
+
+void TargetTracker::update(Detection* detections, int detectionCount) {
+  double now = Stopwatch::now();
+
+  // forget tracks that have not been seen for a while
+  for (int i = 0; i < count; i++) {
+    if (now - tracks[i].lastSeen > maxAge) {
+      tracks[i] = tracks[--count];
+      i--;
+    }
+  }
+
+  for (int d = 0; d < detectionCount; d++) detections[d].track = -1;
+
+  // greedy nearest pairing: the closest detection and track within the gate
+  // go together, then the closest of what is left, and so on
+  bool matched[maxTracks];
+  for (int i = 0; i < count; i++) matched[i] = false;
+  for (;;) {
+    int bestDetection = -1;
+    int bestTrack = -1;
+    float bestDistance = gate;
+    for (int d = 0; d < detectionCount; d++) {
+      if (detections[d].track >= 0) continue;
+      for (int i = 0; i < count; i++) {
+        if (matched[i]) continue;
+        float distance = hypot(tracks[i].x - detections[d].x, tracks[i].y - detections[d].y);
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          bestDetection = d;
+          bestTrack = i;
+        }
+      }
+    }
+    if (bestDetection < 0) break;
+
+    matched[bestTrack] = true;
+    fuse(tracks[bestTrack], detections[bestDetection], now);
+    detections[bestDetection].track = tracks[bestTrack].id;
+  }
+
+  for (int d = 0; d < detectionCount; d++) {
+    if (detections[d].track < 0) detections[d].track = start(detections[d], now);
+  }
+}
+
+void TargetTracker::fuse(Track& track, const Detection& detection, double now) {
+  float sigma = sigmaBase + sigmaPerMeter * detection.range;
+  float measurementVariance = sigma * sigma;
+
+  predict(track, now);
+  float gain = track.variance / (track.variance + measurementVariance);
+  track.x += gain * (detection.x - track.x);
+  track.y += gain * (detection.y - track.y);
+  track.variance *= 1 - gain;
+  track.hits++;
+}
+
+int TargetTracker::start(const Detection& detection, double now) {
+  // full: the stalest track makes room, unless it is in this frame too
+  if (count == maxTracks) {
+    int stalest = 0;
+    for (int i = 1; i < count; i++) {
+      if (tracks[i].lastSeen < tracks[stalest].lastSeen) stalest = i;
+    }
+    if (tracks[stalest].lastSeen >= now) return -1;
+    tracks[stalest] = tracks[--count];
+  }
+
+  float sigma = sigmaBase + sigmaPerMeter * detection.range;
+
+  Track& track = tracks[count++];
+  track.id = nextId++;
+  track.x = detection.x;
+  track.y = detection.y;
+  track.variance = sigma * sigma;
+  track.lastSeen = now;
+  track.hits = 1;
+  return track.id;
+}
+
+bool TargetTracker::estimate(int id, const geometry_msgs::Pose2D& from, Estimate& result) {
+  for (int i = 0; i < count; i++) {
+    if (tracks[i].id != id) continue;
+    if (Stopwatch::now() - tracks[i].lastSeen > maxAge) return false;
+
+    // the variance as of now, without counting this as a sighting
+    Track track = tracks[i];
+    predict(track, Stopwatch::now());
+
+    result.x = track.x;
+    result.y = track.y;
+    result.range = hypot(track.x - from.x, track.y - from.y);
+    result.bearing = atan2(track.y - from.y, track.x - from.x);
+    result.confidence = confidence(track);
+    result.hits = track.hits;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,84 @@
+#ifndef TARGET_TRACKER_H
+#define TARGET_TRACKER_H
+
+#include <geometry_msgs/Pose2D.h>
+
+/**
+ * Follows the cubes in view from one camera frame to the next. A frame's
+ * detections are matched to the tracks together, closest pair first, so
+ * each track takes at most one detection per frame and two cubes a few
+ * centimeters apart keep tracks of their own. A detection with no free
+ * track within gate meters starts a new one.
+ *
+ * Each track is a constant position Kalman filter on the cube's odometry
+ * position. The cube is not expected to move, so prediction only grows the
+ * variance to allow for odometry drift and nudges from the claw. Detections
+ * are trusted less the further away the cube is. Both axes share one
+ * variance, which keeps every filter step down to a few multiplies.
+ *
+ * Confidence is 1 when the position is known exactly and falls to 0 once its
+ * standard deviation reaches sigmaMax. With sigmaMax at 10cm, a lone
+ * detection at pickup range scores a half or less, so it takes a few frames
+ * that agree to become confident.
+ */
+class TargetTracker {
+
+  public:
+
+    struct Estimate {
+      float x;          // filtered odometry position of the cube
+      float y;
+      float range;      // meters from the rover
+      float bearing;    // odometry heading from the rover to the cube
+      float confidence; // 0 to 1
+      int hits;         // detections fused so far
+    };
+
+    // a cube detected at odometry position (x, y), range meters away
+    struct Detection {
+      float x;
+      float y;
+      float range;
+      int track; // set by update: the id of the track it went into, or -1
+    };
+
+    TargetTracker(float gate, float maxAge, float sigmaMax);
+
+    // fuses the count detections from one camera frame
+    void update(Detection* detections, int count);
+
+    // the estimate of track id as seen from from, false if the track is gone
+    bool estimate(int id, const geometry_msgs::Pose2D& from, Estimate& result);
+
+    void clear();
+
+  private:
+
+    struct Track {
+      int id;
+      float x;
+      float y;
+      float variance;  // per axis, square meters
+      double lastSeen; // Stopwatch::now()
+      int hits;
+    };
+
+    static const int maxTracks = 16;
+
+    // brings a track's variance up to now
+    void predict(Track& track, double now);
+    void fuse(Track& track, const Detection& detection, double now);
+    // a new track for detection, -1 if every track was just seen
+    int start(const Detection& detection, double now);
+    float confidence(const Track& track);
+
+    Track tracks[maxTracks];
+    int count;
+    int nextId;
+
+    float gate;
+    float maxAge;
+    float sigmaMax;
+};
+
+#endif /* TARGET_TRACKER_H */
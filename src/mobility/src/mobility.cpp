@@ -9,6 +9,9 @@
 #include <std_msgs/Int16.h>
 #include <std_msgs/UInt8.h>
 #include <std_msgs/String.h>
+#include <std_msgs/UInt16MultiArray.h>
+#include <std_msgs/Float32MultiArray.h>
+#include <std_msgs/UInt8MultiArray.h>
 #include <sensor_msgs/Joy.h>
 #include <sensor_msgs/Range.h>
 #include <geometry_msgs/Pose2D.h>
@@ -21,10 +24,24 @@
 #include "DropOffController.h"
 #include "SearchController.h"
 #include "Calibration.h"
+#include "PoseAverage.h"
+#include "PoseSnapshot.h"
+#include "ArenaFrame.h"
+#include "CoverageGrid.h"
+#include "TargetClaimRegistry.h"
+#include "MissionStateMachine.h"
+#include "LoopTrigger.h"
+#include "Stopwatch.h"
+#include "AngleMath.h"
+#include "PhaseTelemetry.h"
+#include "NestEstimator.h"
+#include "NestAccessScheduler.h"
+#include "SonarHistogram.h"
 
 // To handle shutdown signals so the node quits
 // properly in response to "rosnode kill"
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <signal.h>
 
 using namespace std;
@@ -39,25 +56,45 @@ SearchController searchController;
 Calibration calibrator;
 
 // Mobility Logic Functions
+void mobilityStateMachine();
+void wakeUpStateMachine(double seconds);
 void sendDriveCommand(double linearVel, double angularVel);
-void mapAverage();  // constantly averages last 100 positions from map
+void mapAverage();  // constantly averages the last mapHistorySize positions from map
 
 void continueInterruptedSearch();
 
 void setDestination(float x, float y);
 void setDestinationAngular(float angle, float distance);
 void doPickupControllerMovements();
-void resetPickUpController();
-void resetDropOffController();
+void doDropOffControllerMovements();
+void doFreeMovementStuff();
+void doCalibrationStuff();
+void finishCalibration();
 
 void print(string str);
 void print(float f);
 void print(int i);
 
 // Numeric Variables for rover positioning
+// currentLocation and currentLocationMap are copies of the latest snapshots,
+// refreshed at the start of each callback that uses them so a whole state
+// machine tick works from one consistent pose.
 geometry_msgs::Pose2D currentLocation;
 geometry_msgs::Pose2D currentLocationMap;
 geometry_msgs::Pose2D currentLocationAverage;
+ros::Time currentLocationStamp;
+ros::Time currentLocationMapStamp;
+
+// Written by the odometry callbacks on the pose spinner threads
+PoseSnapshot odometrySnapshot;
+PoseSnapshot mapSnapshot;
+void refreshPoses();
+
+// Odometry callbacks get their own queue and spinner threads so bursts of
+// pose messages are never stuck behind the state machine (or vice versa).
+// Everything else stays on the global queue, serviced by ros::spin().
+ros::CallbackQueue poseCallbackQueue;
+int poseSpinnerThreads = 2;
 
 //POSE VARIABLES
 const float FINGERS_OPEN = M_PI_2;
@@ -85,28 +122,60 @@ geometry_msgs::Pose2D centerLocationOdom;
 int currentMode = 0;//this refers to the "automatic" or "manual" setting on the GUI. 0 and 1 are manual, and 2 and 3 are automatic.
 
 const float mobilityLoopTimeStep = 0.1; // time between the mobility loop calls
+// With ~eventDrivenLoop the loop runs on fresh odometry, obstacle and target
+// messages instead, and ~maxLoopLatency is the longest it may go without running
+bool eventDrivenLoop = false;
+double maxLoopLatency = mobilityLoopTimeStep;
 const float status_publish_interval = 1;
 
 
 // used for calling code once but not in main
 volatile bool initRun = true;
 
-//LOOP CONTROL VARIABLES -- done by Steven
-volatile bool headedToBaseOverwriteAll = false;
-volatile bool giveControlToDropOffController = false;
-volatile bool giveControlToPickupController = false;
-volatile bool giveControlToCalibration = true;
-volatile bool tryToFindTheBase = false;
+//LOOP CONTROL -- which controller has the wheels. See MissionStateMachine.h
+//for the states and what moves the rover between them.
+MissionStateMachine stateMachine;
+void setUpStateMachine();
+
+
+// How many points to use in calculating the map average position.
+// Can be changed per rover with the ~mapHistorySize parameter, even while running.
+int mapHistorySize = 500;
+
+// Running average of the map positions
+PoseAverage mapLocationAverage(mapHistorySize);
 
+// Shared nest-centered frame, and the swarm's record of covered ground in it
+ArenaFrame arenaFrame;
+CoverageGrid* coverageGrid;
+double coverageVisitRadius = 0.5; // meters around the rover counted as searched
+const float coveragePublishInterval = 1; // seconds between deltas
+const int coverageSnapshotEvery = 30; // send the whole grid every this many deltas
+int coverageDeltasSinceSnapshot = 0;
 
-// used to remember place in mapAverage array
-int mapCount = 0;
+// Cubes this rover and its teammates have called dibs on
+TargetClaimRegistry* targetClaims;
 
-// How many points to use in calculating the map average position
-const unsigned int mapHistorySize = 500;
+// Per phase timing of the pickup and drop off controllers
+PhaseTelemetry* phaseTelemetry;
 
-// An array in which to store map positions
-geometry_msgs::Pose2D mapLocation[mapHistorySize];
+// Where the nest is, from the nest tags seen so far. Above nestConfidence the
+// rover heads straight for it; below, it is only the center of a search.
+NestEstimator* nestEstimator;
+double nestConfidence = 0.5;
+void headForNest();
+void anchorArenaFrame();
+double nestEta();
+
+// Takes turns at the nest with the other rovers; without our turn we hold
+// nestStandoff meters out
+NestAccessScheduler* nestAccess;
+double nestStandoff = 1.5;
+
+// With ~vfhSteering, driving to a goal steers through the free directions in
+// the obstacle node's sonar histogram instead of the stop and turn maneuvers
+SonarHistogram* sonarHistogram;
+bool vfhSteering = false;
 
 
 float searchVelocity = 0.2; // meters/second
@@ -125,6 +194,9 @@ ros::Publisher fingerAnglePublish;
 ros::Publisher wristAnglePublish;
 ros::Publisher infoLogPublisher;
 ros::Publisher driveControlPublish;
+ros::Publisher coveragePublish;
+ros::Publisher stateDwellPublish;
+ros::Publisher loopLatencyPublish;
 
 // Subscribers
 ros::Subscriber joySubscriber;
@@ -133,11 +205,14 @@ ros::Subscriber targetSubscriber;
 ros::Subscriber obstacleSubscriber;
 ros::Subscriber odometrySubscriber;
 ros::Subscriber mapSubscriber;
+ros::Subscriber coverageSubscriber;
+ros::Subscriber sonarHistogramSubscriber;
 
 
 // Timers
-ros::Timer stateMachineTimer;
+LoopTrigger stateMachineTrigger(mobilityStateMachine);
 ros::Timer publish_status_timer;
+ros::Timer coverageTimer;
 
 // records time for delays in sequanced actions, 1 second resolution.
 time_t timerStartTime;
@@ -154,13 +229,45 @@ tf::TransformListener *tfListener;
 void sigintEventHandler(int signal);
 
 //Callback handlers
+// merges what the other rovers have covered; our own deltas come back too and
+// are skipped
+void coverageHandler(const std_msgs::UInt16MultiArray::ConstPtr& message) {
+    if (!message->layout.dim.empty() && message->layout.dim[0].label == publishedName) return;
+    coverageGrid->merge(*message);
+}
+
+void sonarHistogramHandler(const std_msgs::UInt8MultiArray::ConstPtr& message) {
+    sonarHistogram->update(message->data);
+}
+
+void coverageTimerEventHandler(const ros::TimerEvent&) {
+    std_msgs::UInt16MultiArray coverage;
+
+    // an occasional full snapshot repairs any deltas a teammate missed
+    if (++coverageDeltasSinceSnapshot >= coverageSnapshotEvery) {
+        coverageDeltasSinceSnapshot = 0;
+        coverageGrid->getSnapshot(coverage);
+    } else if (!coverageGrid->takeDelta(coverage)) {
+        return;
+    }
+
+    std_msgs::MultiArrayDimension sender;
+    sender.label = publishedName;
+    sender.size = coverage.data.size();
+    sender.stride = 1;
+    coverage.layout.dim.push_back(sender);
+    coveragePublish.publish(coverage);
+}
+
 void joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message);
 void modeHandler(const std_msgs::UInt8::ConstPtr& message);
 void targetHandler(const apriltags_ros::AprilTagDetectionArray::ConstPtr& tagInfo);
 void obstacleHandler(const std_msgs::UInt8::ConstPtr& message);
 void odometryHandler(const nav_msgs::Odometry::ConstPtr& message);
 void mapHandler(const nav_msgs::Odometry::ConstPtr& message);
-void mobilityStateMachine(const ros::TimerEvent&);
+void coverageHandler(const std_msgs::UInt16MultiArray::ConstPtr& message);
+void sonarHistogramHandler(const std_msgs::UInt8MultiArray::ConstPtr& message);
+void coverageTimerEventHandler(const ros::TimerEvent& event);
 void publishStatusTimerEventHandler(const ros::TimerEvent& event);
 
 int main(int argc, char **argv) {
@@ -176,12 +283,6 @@ int main(int argc, char **argv) {
     centerLocationOdom.x = 0;
     centerLocationOdom.y = 0;
 
-    for (int i = 0; i < 100; i++) {
-        mapLocation[i].x = 0;
-        mapLocation[i].y = 0;
-        mapLocation[i].theta = 0;
-    }
-
     if (argc >= 2) {
         publishedName = argv[1];
         cout << "Welcome to the world of tomorrow " << publishedName
@@ -195,6 +296,101 @@ int main(int argc, char **argv) {
     ros::init(argc, argv, (publishedName + "_MOBILITY"), ros::init_options::NoSigintHandler);
     ros::NodeHandle mNH;
 
+    ros::NodeHandle param("~");
+    int defaultHistorySize = mapHistorySize;
+    param.param("mapHistorySize", mapHistorySize, mapHistorySize);
+    if (mapHistorySize <= 0) mapHistorySize = defaultHistorySize;
+    mapLocationAverage.setWindowSize(mapHistorySize);
+    param.param("poseSpinnerThreads", poseSpinnerThreads, poseSpinnerThreads);
+    if (poseSpinnerThreads < 1) poseSpinnerThreads = 1;
+    param.param("eventDrivenLoop", eventDrivenLoop, eventDrivenLoop);
+    param.param("maxLoopLatency", maxLoopLatency, maxLoopLatency);
+
+    ros::NodeHandle poseNH;
+    poseNH.setCallbackQueue(&poseCallbackQueue);
+
+    // search pattern for this rover
+    string searchStrategyName;
+    SearchStrategy::Settings searchSettings;
+    param.param("searchStrategy", searchStrategyName, string("random_walk"));
+    param.param("searchSpacing", searchSettings.spacing, searchSettings.spacing);
+    param.param("searchStepLength", searchSettings.stepLength, searchSettings.stepLength);
+    param.param("arenaRadius", searchSettings.arenaRadius, searchSettings.arenaRadius);
+    param.param("levyMinFlight", searchSettings.minFlight, searchSettings.minFlight);
+    param.param("levyMaxFlight", searchSettings.maxFlight, searchSettings.maxFlight);
+    param.param("levyMu", searchSettings.levyMu, searchSettings.levyMu);
+    param.param("roverIndex", searchSettings.roverIndex, searchSettings.roverIndex);
+    param.param("roverCount", searchSettings.roverCount, searchSettings.roverCount);
+
+    SearchStrategy* strategy = SearchStrategy::create(searchStrategyName, searchSettings, rng);
+    if (strategy == NULL) {
+        cout << "Unknown search strategy " << searchStrategyName << ", using random_walk" << endl;
+        strategy = SearchStrategy::create("random_walk", searchSettings, rng);
+    }
+    searchController.setStrategy(strategy);
+
+    // coverage grid spans the arena plus a margin for the walls
+    double coverageCellSize = 0.5;
+    int coverageMaxSkips = 20;
+    param.param("coverageCellSize", coverageCellSize, coverageCellSize);
+    param.param("coverageVisitRadius", coverageVisitRadius, coverageVisitRadius);
+    param.param("coverageMaxSkips", coverageMaxSkips, coverageMaxSkips);
+    coverageGrid = new CoverageGrid(arenaFrame, searchSettings.arenaRadius + 1.0, coverageCellSize);
+    searchController.setCoverage(coverageGrid, coverageMaxSkips);
+
+    double claimLeaseSeconds = 10;
+    double claimMatchRadius = 0.3;
+    double claimMaxMatchRadius = 1.5;
+    double arenaHeadingSigma = 0.1;
+    param.param("claimLeaseSeconds", claimLeaseSeconds, claimLeaseSeconds);
+    param.param("claimMatchRadius", claimMatchRadius, claimMatchRadius);
+    param.param("claimMaxMatchRadius", claimMaxMatchRadius, claimMaxMatchRadius);
+    param.param("arenaHeadingSigma", arenaHeadingSigma, arenaHeadingSigma);
+    arenaFrame.setHeadingSigma(arenaHeadingSigma);
+    targetClaims = new TargetClaimRegistry(arenaFrame, publishedName, claimLeaseSeconds, claimMatchRadius, claimMaxMatchRadius);
+    pickUpController.setClaimRegistry(targetClaims);
+
+    double trackerConfidence = 0.7;
+    param.param("trackerConfidence", trackerConfidence, trackerConfidence);
+    pickUpController.setTrackerConfidence(trackerConfidence);
+
+    // servo approach, given as flat (range, yaw gain, speed) rows
+    bool visualServo = false;
+    double servoHandoffRange = 0.25;
+    vector<double> servoSchedule;
+    param.param("visualServo", visualServo, visualServo);
+    param.param("servoHandoffRange", servoHandoffRange, servoHandoffRange);
+    param.getParam("servoSchedule", servoSchedule); // left empty keeps the built in schedule
+    pickUpController.setServoSchedule(servoSchedule, servoHandoffRange);
+    pickUpController.setVisualServo(visualServo);
+
+    double phaseWindowSeconds = 60;
+    param.param("phaseWindowSeconds", phaseWindowSeconds, phaseWindowSeconds);
+    phaseTelemetry = new PhaseTelemetry(phaseWindowSeconds);
+    double nestSigmaMax = 1.0;
+    param.param("nestSigmaMax", nestSigmaMax, nestSigmaMax);
+    param.param("nestConfidence", nestConfidence, nestConfidence);
+    nestEstimator = new NestEstimator(nestSigmaMax);
+
+    double nestLeaseSeconds = 10;
+    int nestConcurrentRovers = 2;
+    double nestMaxHoldSeconds = 60;
+    param.param("nestLeaseSeconds", nestLeaseSeconds, nestLeaseSeconds);
+    param.param("nestConcurrentRovers", nestConcurrentRovers, nestConcurrentRovers);
+    param.param("nestMaxHoldSeconds", nestMaxHoldSeconds, nestMaxHoldSeconds);
+    param.param("nestStandoff", nestStandoff, nestStandoff);
+    nestAccess = new NestAccessScheduler(arenaFrame, publishedName, nestLeaseSeconds, nestConcurrentRovers, nestMaxHoldSeconds);
+
+    int vfhThreshold = 100;
+    double vfhMaxDeviation = M_PI_2;
+    param.param("vfhSteering", vfhSteering, vfhSteering);
+    param.param("vfhThreshold", vfhThreshold, vfhThreshold);
+    param.param("vfhMaxDeviation", vfhMaxDeviation, vfhMaxDeviation);
+    sonarHistogram = new SonarHistogram(vfhThreshold, 0.5, vfhMaxDeviation);
+
+    pickUpController.setTelemetry(phaseTelemetry, phaseTelemetry->addController(PickUpController::NUM_STATES));
+    dropOffController.setTelemetry(phaseTelemetry, phaseTelemetry->addController(DropOffController::NUM_STATES));
+
     // Register the SIGINT event handler so the node can shutdown properly
     signal(SIGINT, sigintEventHandler);
 
@@ -202,8 +398,13 @@ int main(int argc, char **argv) {
     modeSubscriber = mNH.subscribe((publishedName + "/mode"), 1, modeHandler);
     targetSubscriber = mNH.subscribe((publishedName + "/targets"), 100, targetHandler);
     obstacleSubscriber = mNH.subscribe((publishedName + "/obstacle"), 100, obstacleHandler);
-    odometrySubscriber = mNH.subscribe((publishedName + "/odom/filtered"), 100, odometryHandler);
-    mapSubscriber = mNH.subscribe((publishedName + "/odom/ekf"), 100, mapHandler);
+    odometrySubscriber = poseNH.subscribe((publishedName + "/odom/filtered"), 100, odometryHandler);
+    mapSubscriber = poseNH.subscribe((publishedName + "/odom/ekf"), 100, mapHandler);
+    coverageSubscriber = mNH.subscribe("/coverage", 10, coverageHandler);
+    sonarHistogramSubscriber = mNH.subscribe((publishedName + "/sonarHistogram"), 10, sonarHistogramHandler);
+    targetClaims->advertise(mNH);
+    nestAccess->advertise(mNH);
+    phaseTelemetry->advertise(mNH, publishedName);
 
     status_publisher = mNH.advertise<std_msgs::String>((publishedName + "/status"), 1, true);
     stateMachinePublish = mNH.advertise<std_msgs::String>((publishedName + "/state_machine"), 1, true);
@@ -211,9 +412,16 @@ int main(int argc, char **argv) {
     wristAnglePublish = mNH.advertise<std_msgs::Float32>((publishedName + "/wristAngle/cmd"), 1, true);
     infoLogPublisher = mNH.advertise<std_msgs::String>("/infoLog", 10, true);
     driveControlPublish = mNH.advertise<geometry_msgs::Twist>((publishedName + "/driveControl"), 10);
+    coveragePublish = mNH.advertise<std_msgs::UInt16MultiArray>("/coverage", 10);
+    stateDwellPublish = mNH.advertise<std_msgs::Float32MultiArray>((publishedName + "/stateDwell"), 1, true);
+    loopLatencyPublish = mNH.advertise<std_msgs::Float32MultiArray>((publishedName + "/loopLatency"), 1, true);
+
+    setUpStateMachine();
 
     publish_status_timer = mNH.createTimer(ros::Duration(status_publish_interval), publishStatusTimerEventHandler);
-    stateMachineTimer = mNH.createTimer(ros::Duration(mobilityLoopTimeStep), mobilityStateMachine);
+    stateMachineTrigger.start(mNH, eventDrivenLoop, eventDrivenLoop ? maxLoopLatency : mobilityLoopTimeStep);
+    Stopwatch::setWakeupHandler(wakeUpStateMachine);
+    coverageTimer = mNH.createTimer(ros::Duration(coveragePublishInterval), coverageTimerEventHandler);
 //http://docs.ros.org/jade/api/roscpp/html/classros_1_1NodeHandle.html#a3a267bf5bac429dc0948ca0bd0492a16
 	/*
 Timer ros::NodeHandle::createTimer 	( 	Duration  	period,
@@ -248,6 +456,9 @@ Parameters:
 
     timerStartTime = time(0);
 
+    ros::AsyncSpinner poseSpinner(poseSpinnerThreads, &poseCallbackQueue);
+    poseSpinner.start();
+
     ros::spin();
 
     return EXIT_SUCCESS;
@@ -269,19 +480,10 @@ fingerAngle.data = 0; wristAngle.data = 0;
 void doCheat()
 {
 
-if (debug_cheatStartWithCube)
-{
-headedToBaseOverwriteAll = true;
-setDestination(origin.x, origin.y);
-giveControlToPickupController = false;
-std_msgs::Float32 fingerAngle,wristAngle;
-wristAngle.data = 0.80;
-wristAnglePublish.publish(wristAngle);
-}
+//starting with a cube happens in finishCalibration()
 if (debug_cheatSkipCalibration)
 {
-
-giveControlToCalibration = false;
+finishCalibration();
 }
 
 }
@@ -297,6 +499,11 @@ origin.y = currentLocation.y + (0.50+0.25) * sin(currentLocation.theta);
 
 
 setDestination(origin.x,origin.y);
+nestEstimator->seed(origin.x, origin.y, 0.3);
+anchorArenaFrame();
+
+//the search pattern is laid out around the collection zone
+searchController.setSearchCenter(origin.x, origin.y);
 
 print("done initializing");
 }
@@ -306,7 +513,7 @@ print("done initializing");
 //steven code. used in pickupcontroller and sets the angle for you. cos thats how it should be done.
 void setDestination(float x, float y)
 {
-if (headedToBaseOverwriteAll && !tryToFindTheBase)
+if (stateMachine.getState() == MissionStateMachine::RETURNING)
 {
 goalLocation.x = origin.x;
 goalLocation.y = origin.y;
@@ -344,40 +551,144 @@ because ROS doesnt like the Sleep() function (it stacks it up improperly i guess
 Note that this code is placed after all the other movement code, so as to overwrite it.
 */
 float driveOnTimerVelocity, driveOnTimerTorque, driveOnTimerDuration;
-ros::Time driveOnTimerStartingTime;
+Stopwatch driveOnTimerStopwatch;
 bool isDoingDriveOnTimer = false;//this boolean value is meant to trump all other forms of movement.
 bool hasBeenLongEnoughForDriveOnTimer()
 {
-ros::Duration timeDifferenceObject = ros::Time::now() - driveOnTimerStartingTime;
-return (timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) > driveOnTimerDuration;
+return driveOnTimerStopwatch.waitFor(driveOnTimerDuration);
 }
 
 void driveOnTimer(float velocity, float torque, float duration)
 {
 isDoingDriveOnTimer = true;
-driveOnTimerStartingTime = ros::Time::now();
+driveOnTimerStopwatch.restart();
 driveOnTimerVelocity = velocity; driveOnTimerTorque = torque; driveOnTimerDuration = duration;
 }
+/*
+entry and exit actions for the states, see setUpStateMachine()
+*/
 //instead of calling pickupController.reset
-void resetPickUpController()
+void leavePickUp()
 {
+//how the time went, phase by phase
+print(pickUpController.getPhaseLog());
 pickUpController.reset();
-giveControlToPickupController = false;
+//whatever cube we were after is free for the others again
+targetClaims->release();
+}
+
+void enterDropOff()
+{
+dropOffController.beginDropOff();
+nestAccess->setDroppingOff(true);
 }
-void resetDropOffController()
+
+void leaveDropOff()
 {
 dropOffController.reset();
-giveControlToDropOffController = false;
+nestAccess->setDroppingOff(false);
+}
+
+//got da cube! time 2 bring it home~
+void enterReturning()
+{
+headForNest();
+setDestination(origin.x, origin.y);
+nestAccess->request(currentLocation.x, currentLocation.y, nestEta());
+std_msgs::Float32 wristAngle;
+wristAngle.data = 0.80;
+wristAnglePublish.publish(wristAngle);
+}
+
+//this is to make it try to find the base with random search.
+void enterFindingBase()
+{
+//we got to where the nest should be and it is not there
+nestEstimator->addMiss();
+anchorArenaFrame();
+searchController.initTryingToFindBase(nestEstimator->getX(), nestEstimator->getY());
+}
+
+//trust the nest estimate over the last drop off once it is good enough
+void headForNest()
+{
+if (nestEstimator->getConfidence() < nestConfidence)
+	return;
+origin.x = nestEstimator->getX();
+origin.y = nestEstimator->getY();
+}
+
+// The arena frame is centered on the fused nest estimate, which every rover
+// converges on from its own sightings and drop offs, rather than on whatever
+// pose this rover last dropped a cube at
+void anchorArenaFrame()
+{
+if (!nestEstimator->isSeeded())
+	return;
+arenaFrame.setNest(nestEstimator->getX(), nestEstimator->getY(), nestEstimator->getSigma());
+}
+
+void leaveFindingBase()
+{
+searchController.tryingToFindTheBase = false;
+}
+
+//dropped off (or dropped the cube somewhere else), the nest is free
+void leaveHomeward()
+{
+nestAccess->release();
+}
+
+//seconds to the nest at search speed
+double nestEta()
+{
+return hypot(origin.x - currentLocation.x, origin.y - currentLocation.y) / searchVelocity;
+}
+
+//on the way home, stop short of the nest until it is our turn
+void doReturningMovements()
+{
+if (!nestAccess->isGranted() && hypot(origin.x - currentLocation.x, origin.y - currentLocation.y) < nestStandoff)
+{
+	sendDriveCommand(0,0);
+	return;
+}
+doFreeMovementStuff();
+}
 
+void setUpStateMachine()
+{
+typedef MissionStateMachine M;
+//                                    entry             during                        exit
+stateMachine.setActions(M::CALIBRATING,  NULL,             doCalibrationStuff,           NULL);
+stateMachine.setActions(M::FORAGING,     NULL,             doFreeMovementStuff,          NULL);
+stateMachine.setActions(M::PICKING_UP,   NULL,             doPickupControllerMovements,  leavePickUp);
+stateMachine.setActions(M::HOMEWARD,     NULL,             doFreeMovementStuff,          leaveHomeward);
+stateMachine.setActions(M::RETURNING,    enterReturning,   doReturningMovements,         NULL);
+stateMachine.setActions(M::FINDING_BASE, enterFindingBase, NULL,                         leaveFindingBase);
+stateMachine.setActions(M::DROPPING_OFF, enterDropOff,     doDropOffControllerMovements, leaveDropOff);
+stateMachine.start(M::CALIBRATING);
 }
 
 //returns angleError
 
 void doPickupControllerMovements()
 {
+//another rover claimed our cube before we did. back off unless the cube is
+//already between our fingers
+if (targetClaims->lostClaim()
+	&& (pickUpController.getState() == PickUpController::FIXING_CAMERA || pickUpController.getState() == PickUpController::WAITING_AND_CHECKING_CAMERA_AGAIN
+	|| pickUpController.getState() == PickUpController::APPROACHING_CUBE || pickUpController.getState() == PickUpController::SERVOING_TO_CUBE))
+{
+print("cube was claimed by another rover");
+stateMachine.fire(MissionStateMachine::PICKUP_ABORTED);
+continueInterruptedSearch();
+return;
+}
+
 if (pickUpController.getState() == pickUpController.DONE_FAILING)
 {
-resetPickUpController();
+stateMachine.fire(MissionStateMachine::PICKUP_ABORTED);
 geometry_msgs::Pose2D tempLocation = searchController.search(currentLocation);
 setDestination(tempLocation.x,tempLocation.y);
 return;
@@ -415,17 +726,13 @@ pickUpController.lastAngleError = result.angleError;
 		
 		//got da cube! time 2 bring it home~
                 if (result.pickedUp) {
-                    resetPickUpController();
-
-//the cube was just picked up! set the destination to the origin!
                     result.pickedUp = false;
 
-//setting the destination to the origin ...
-headedToBaseOverwriteAll = true;
-setDestination(origin.x, origin.y);
-giveControlToPickupController = false;
-wristAngle.data = 0.80;
-wristAnglePublish.publish(wristAngle);
+//one less cube in the cluster it came from (if it came from one)
+searchController.clusters.cubeTaken(currentLocation.x, currentLocation.y);
+
+//the cube was just picked up! entering RETURNING sets the destination to the origin
+stateMachine.fire(MissionStateMachine::CUBE_PICKED_UP);
 
                     return;
                 }
@@ -446,23 +753,43 @@ const int countRight = dropOffController.getCountRight();
 
 stringstream ss;
 float duration;
-ros::Duration timeDifferenceObject;
 std_msgs::Float32 fingerAngle;
 std_msgs::Float32 wristAngle;
 
 dropOffController.setTagCountToZeroIfAppropriate();
 
+//the nest is in sight, but other rovers go in first
+int dropOffState = dropOffController.getState();
+if (!nestAccess->isGranted() && (dropOffState == DropOffController::FINDING_BASE || dropOffState == DropOffController::SCOOTING_CLOSER_TO_BASE
+	|| dropOffState == DropOffController::ADJUSTING_ANGLE_FOR_ENTRY || dropOffState == DropOffController::PAUSING_BEFORE_ROTATING_AGAIN))
+{
+	sendDriveCommand(0,0);
+	return;
+}
+
 
 switch(dropOffController.getState()) {
 case (DropOffController::FINDING_BASE):
-//spin until you find a tag
+//drive to where the nest should be, or spin until you find a tag
 if (countLeft > 0 || countRight > 0)
 {
 	//found the base!
 	dropOffController.numTimesPausedAndTurned = 0;//reset this value to 0
 	dropOffController.setState(DropOffController::SCOOTING_CLOSER_TO_BASE);
 	sendDriveCommand(0,0);
-	dropOffController.omniTimerStartingTime = ros::Time::now();//reset the timer again
+	dropOffController.omniTimer.restart();//reset the timer again
+}
+else if (nestEstimator->getConfidence() >= nestConfidence)
+{
+float distance = hypot(nestEstimator->getX() - currentLocation.x, nestEstimator->getY() - currentLocation.y);
+float turn = angle_math::difference(atan2(nestEstimator->getY() - currentLocation.y, nestEstimator->getX() - currentLocation.x), currentLocation.theta);
+if (distance < NAVIGATION_ACCURACY)
+{
+	nestEstimator->addMiss();//we are there and see no tags, so the estimate is off
+	anchorArenaFrame();
+}
+//turn towards it, only creeping forward until lined up
+sendDriveCommand(fabs(turn) < 0.5 ? searchVelocity : 0.05, max(-0.35f, min(0.35f, turn)));
 }
 else
 {
@@ -475,8 +802,7 @@ break;
 case (DropOffController::SCOOTING_CLOSER_TO_BASE):
 //radiusTho = 0;
 duration = 0.00;
-timeDifferenceObject = ros::Time::now() - dropOffController.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!dropOffController.omniTimer.waitFor(duration))
 {
 //scoot!
 sendDriveCommand(0.20,0);
@@ -497,12 +823,11 @@ duration = 0.75;
 	if (countLeft == 0 && countRight == 0) 
 	{
 	//go back if theres no tags seen lately
-	dropOffController.setState(DropOffController::FINDING_BASE);
+	dropOffController.setState(DropOffController::FINDING_BASE, true);
 	break;
 	}
 
-timeDifferenceObject = ros::Time::now() - dropOffController.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!dropOffController.omniTimer.waitFor(duration))
 {
 if (countRight > countLeft)
 	sendDriveCommand(0.05,-0.30);
@@ -518,31 +843,29 @@ else
 	{
 	dropOffController.numTimesPausedAndTurned++;
 	if (dropOffController.numTimesPausedAndTurned > DropOffController::giveUpAndDropAfterTurningThisManyTimes)
-		dropOffController.setState(DropOffController::DROPPING_CUBE);//give up and drop the cube
+		dropOffController.setState(DropOffController::DROPPING_CUBE, true);//give up and drop the cube
 	else
 		dropOffController.setState(DropOffController::PAUSING_BEFORE_ROTATING_AGAIN);
 	}
-  dropOffController.omniTimerStartingTime = ros::Time::now();//reset the timer again
+  dropOffController.omniTimer.restart();//reset the timer again
 }//end if/else
 break;
 
 case (DropOffController::PAUSING_BEFORE_ROTATING_AGAIN):
 duration = 1.5;
-timeDifferenceObject = ros::Time::now() - dropOffController.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!dropOffController.omniTimer.waitFor(duration))
 ;//wait
 else
 {
 dropOffController.setState(DropOffController::ADJUSTING_ANGLE_FOR_ENTRY);
-dropOffController.omniTimerStartingTime = ros::Time::now();//reset the timer again
+dropOffController.omniTimer.restart();//reset the timer again
 }
 
 break;
 
 case (DropOffController::ENTERING_BASE):
 duration = 2.0;
-timeDifferenceObject = ros::Time::now() - dropOffController.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!dropOffController.omniTimer.waitFor(duration))
 {
 // move forward into base
 sendDriveCommand(0.20,0);
@@ -570,16 +893,17 @@ wristAnglePublish.publish(wristAngle);
 origin.x = currentLocation.x;
 origin.y = currentLocation.y;
 origin.theta = currentLocation.theta;
+nestEstimator->addDropOff(currentLocation);
+anchorArenaFrame();
 
 
 dropOffController.setState(DropOffController::BACKING_OUT_OF_BASE);
-dropOffController.omniTimerStartingTime = ros::Time::now();//reset the timer again
+dropOffController.omniTimer.restart();//reset the timer again
 break;
 
 case (DropOffController::BACKING_OUT_OF_BASE):
 duration = 4.0;
-timeDifferenceObject = ros::Time::now() - dropOffController.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!dropOffController.omniTimer.waitFor(duration))
 {
 //back out
 sendDriveCommand(-0.20,0);
@@ -599,7 +923,7 @@ fingerAngle.data = 0;
 fingerAnglePublish.publish(fingerAngle);
 
 
-resetDropOffController();
+stateMachine.fire(MissionStateMachine::DROPPED_OFF);
 
 break;
 
@@ -631,18 +955,18 @@ return (currentDistanceFromStart / distanceFromStartToFinish) >= percentageTrave
 //only use this if you are using it on everything. it is for making angles comparable.
 float fixAngle(float myAngle)
 {
-float twopi = 2*3.1415926535;
-while(myAngle < 0)
-	myAngle = myAngle + twopi;
-while (myAngle > twopi)
-	myAngle = myAngle - twopi;
+return angle_math::wrapPositive(myAngle);
 }
 
 void doFreeMovementStuff()
 {
+//the drive on timer has the wheels for now
+if (isDoingDriveOnTimer)
+	return;
+
 float rotateOnlyAngleTolerance = 0.10;
 //print debug stuff
-float errorYaw = angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta);
+float errorYaw = angle_math::difference(goalLocation.theta, currentLocation.theta);
 stringstream ss;
 
 float duration;//for use in switch
@@ -660,14 +984,13 @@ if (fabs(errorYaw) > rotateOnlyAngleTolerance)
 else
 {
 	//else it the angle is done being fixed
-	searchController.omniTimerStartingTime = ros::Time::now();
+	searchController.omniTimer.restart();
 	searchController.setState(SearchController::WAITING_FOR_MOMENTUM_BEFORE_MOVING);
 }
 break;
 case (SearchController::WAITING_FOR_MOMENTUM_BEFORE_MOVING):
 duration = 1.0;
-searchController.timeDifferenceObject = ros::Time::now() - searchController.omniTimerStartingTime;
-if ((searchController.timeDifferenceObject.sec + searchController.timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!searchController.omniTimer.waitFor(duration))
 {
 sendDriveCommand(0,0);
 //do nothing. just wait before turning.
@@ -687,7 +1010,12 @@ case (SearchController::MOVING_TO_GOAL):
 if (!travelledFarEnough())
 {
 //keep marching to goal. stay in this state.
-sendDriveCommand(searchVelocity,0);
+float bearing = angle_math::difference(atan2(goalLocation.y - currentLocation.y, goalLocation.x - currentLocation.x), currentLocation.theta);
+float direction;
+if (vfhSteering && sonarHistogram->steer(bearing, direction) && direction != bearing)
+	sendDriveCommand(searchVelocity, max(-0.35f, min(0.35f, direction)));//around whatever is in the way
+else
+	sendDriveCommand(searchVelocity,0);
 }
 else//it has travelled far enough. check if it is within range of goal, and then change state.
 {
@@ -700,7 +1028,7 @@ setDestination(goalLocation.x,goalLocation.y);
 }
 else //if close enough to the destination
 {
-searchController.omniTimerStartingTime = ros::Time::now();
+searchController.omniTimer.restart();
 searchController.setState(SearchController::REACHED_GOAL_PAUSE);
 }//end else distance>1
 
@@ -716,8 +1044,7 @@ break;
 
 case (SearchController::REACHED_GOAL_PAUSE):
 duration = 1.00;
-searchController.timeDifferenceObject = ros::Time::now() - searchController.omniTimerStartingTime;
-if ((searchController.timeDifferenceObject.sec + searchController.timeDifferenceObject.nsec/1000000000.0) < duration)
+if (!searchController.omniTimer.waitFor(duration))
 {
 //do nothing. turn a bit
 sendDriveCommand(0,0);
@@ -730,12 +1057,9 @@ searchController.accumulatedAngle = 0;
 searchController.lastAngle = currentLocation.theta;
 }
 
-//this is to make it try to find the base with random search.
-if (headedToBaseOverwriteAll && !tryToFindTheBase)
-{
-tryToFindTheBase = true;
-searchController.initTryingToFindBase(origin.x,origin.y);
-}
+//this is to make it try to find the base with random search. does nothing
+//unless we are headed home and not already looking for the base
+stateMachine.fire(MissionStateMachine::BASE_NOT_FOUND);
 
 
 
@@ -744,7 +1068,7 @@ break;
 case (SearchController::TAKING_A_LOOK):
 //turn 360 degrees and walk away :^)
 
-if (searchController.accumulatedAngle > 2*3.1415926535)
+if (searchController.accumulatedAngle > angle_math::twoPi)
 {
 sendDriveCommand(0,0);
 searchController.setState(SearchController::REACHED_GOAL);
@@ -753,7 +1077,8 @@ else
 {
 //keep spinning
 sendDriveCommand(0.05,0.45);//needs to be able to actually see it
-searchController.accumulatedAngle += fabs(currentLocation.theta - searchController.lastAngle);
+//the short way round, or crossing +/-pi would count as most of a turn
+searchController.accumulatedAngle += fabs(angle_math::difference(currentLocation.theta, searchController.lastAngle));
 searchController.lastAngle = currentLocation.theta;
 }
 
@@ -788,21 +1113,19 @@ void doCalibrationStuff()
 {
 
 float duration;
-ros::Duration timeDifferenceObject;
 
 
 switch (calibrator.getState()) {
 case (Calibration::STATE_INIT):
 sendDriveCommand(0,0);
 resetClaw();
-calibrator.omniTimerStartingTime = ros::Time::now();
+calibrator.omniTimer.restart();
 calibrator.setState(Calibration::BACKING_UP);
 break;
 
 case(Calibration::BACKING_UP):
 duration = Calibration::backupTime / 2 ;
-timeDifferenceObject = ros::Time::now() - calibrator.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration) {
+if (!calibrator.omniTimer.waitFor(duration)) {
 //back up
 sendDriveCommand(-1 * PickUpController::PICKUP_VELOCITY,0);
 }
@@ -810,14 +1133,13 @@ else
 {
 sendDriveCommand(0,0);
 calibrator.setState(Calibration::WAITING_1);
-calibrator.omniTimerStartingTime = ros::Time::now();
+calibrator.omniTimer.restart();
 }//end else
 break;
 
 case (Calibration::WAITING_1):
 duration = 1.0;
-timeDifferenceObject = ros::Time::now() - calibrator.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration) {
+if (!calibrator.omniTimer.waitFor(duration)) {
 //do nothing. waiting for momentum to stop.
 }
 else
@@ -825,7 +1147,7 @@ else
 //save the coordinates and proceed
 calibrator.backupLocation.x = currentLocation.x;
 calibrator.backupLocation.y = currentLocation.y;
-calibrator.omniTimerStartingTime = ros::Time::now();
+calibrator.omniTimer.restart();
 calibrator.setState(Calibration::MOVING_FORWARD);
 }
 
@@ -833,15 +1155,14 @@ break;
 
 case (Calibration::MOVING_FORWARD):
 duration = Calibration::backupTime;
-timeDifferenceObject = ros::Time::now() - calibrator.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration) {
+if (!calibrator.omniTimer.waitFor(duration)) {
 sendDriveCommand(PickUpController::PICKUP_VELOCITY,0);
 }
 else
 {
 sendDriveCommand(0,0);
 calibrator.setState(Calibration::WAITING_2);
-calibrator.omniTimerStartingTime = ros::Time::now();
+calibrator.omniTimer.restart();
 }
 
 break;
@@ -849,8 +1170,7 @@ break;
 case (Calibration::WAITING_2):
 duration = 1.0;
 
-timeDifferenceObject = ros::Time::now() - calibrator.omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration) {
+if (!calibrator.omniTimer.waitFor(duration)) {
 //do nothing. waiting for momentum to stop.
 }
 else
@@ -869,7 +1189,7 @@ case (Calibration::DONE_CALIBRATING):
 //meters per second
 calibrator.pickupSpeed = hypot(calibrator.frontLocation.x - calibrator.backupLocation.x, calibrator.frontLocation.y - calibrator.backupLocation.y) / Calibration::backupTime;
 calibrator.reset();
-giveControlToCalibration = false;
+finishCalibration();
 }
 break;
 
@@ -877,6 +1197,15 @@ break;
 
 }//end doCalibrationStuff()
 
+void finishCalibration()
+{
+stateMachine.fire(MissionStateMachine::CALIBRATED);
+
+//debugging cheat: pretend we just picked up a cube
+if (debug_cheatStartWithCube)
+	stateMachine.fire(MissionStateMachine::CUBE_PICKED_UP);
+}
+
 
 void doDriveOnTimerStuff()
 {
@@ -891,13 +1220,20 @@ continueInterruptedSearch();
 }
 }//end doDriveOnTimerStuff
 
-void mobilityStateMachine(const ros::TimerEvent&) {
+void mobilityStateMachine() {
 
     std_msgs::String stateMachineMsg;
 
 
     int returnToSearchDelay = 3;
 
+    refreshPoses();
+
+    // the map heading is what lines odometry up with the shared arena frame
+    if (!currentLocationMapStamp.isZero()) {
+        arenaFrame.update(currentLocation, currentLocationMap);
+    }
+
     // calls the averaging function, also responsible for
     // transform from Map frame to odom frame. its important this is called in manual mode because the map data still changes in manual mode.
     mapAverage();
@@ -905,6 +1241,8 @@ void mobilityStateMachine(const ros::TimerEvent&) {
     // Robot is in automode
     if (currentMode == 2 || currentMode == 3) {
 
+coverageGrid->markVisited(currentLocation, coverageVisitRadius);
+
 
 
 
@@ -917,33 +1255,12 @@ return;
 
 
 
-if (giveControlToCalibration) {
-doCalibrationStuff();
-return;
-}
-stateMachineMsg.data = "TRANSFORMING";
-
-
-      
-
-if (giveControlToPickupController == true)
-{
-doPickupControllerMovements();
-}
-
-//really needing to do a clean surgery replacement of this if() with dropoff controller variable.
-if (giveControlToDropOffController)
-{
-doDropOffControllerMovements();
-}
-
-if (!isDoingDriveOnTimer && !giveControlToPickupController && !giveControlToDropOffController)//some of the code in here fires when target is Collected (the code to return to base for example)
-{
-doFreeMovementStuff();
-}
+//runs whichever controller the current state hands the wheels to
+stateMachine.tick();
+stateMachineMsg.data = stateMachine.getStateName();
 
 //driveOnTimer overwrites everything, so you have to be careful what you allow to start it. This could be problematic for pickup controller?
-if (isDoingDriveOnTimer)
+if (isDoingDriveOnTimer && !stateMachine.isIn(MissionStateMachine::CALIBRATING))
 {
 doDriveOnTimerStuff();
 }
@@ -963,6 +1280,12 @@ doDriveOnTimerStuff();
     }
 }
 
+// a controller is waiting on a Stopwatch; run the loop again when it is done
+void wakeUpStateMachine(double seconds)
+{
+stateMachineTrigger.wakeIn(seconds);
+}
+
 void sendDriveCommand(double linearVel, double angularError)
 {
 
@@ -983,6 +1306,7 @@ if (velocity.angular.z != 0 && fabs(velocity.angular.z) < minStrength)
 
     // publish the drive commands
     driveControlPublish.publish(velocity);
+    stateMachineTrigger.commandSent();
 }
 
 
@@ -1013,7 +1337,7 @@ void continueInterruptedSearch()//for use when traveling across the field: eithe
 {
 
 //list all of the special cases in here. this is if the robot needs to remember the last path it was taking. otherwise just assign a new random path.
-if (headedToBaseOverwriteAll == true && tryToFindTheBase == false) 
+if (stateMachine.getState() == MissionStateMachine::RETURNING)
 {
 setDestination(origin.x, origin.y);
 }
@@ -1031,13 +1355,9 @@ setDestination(tempLocation.x,tempLocation.y);
 
 void doHitTheBaseCode()
 {
-tryToFindTheBase = false;
-searchController.tryingToFindTheBase = tryToFindTheBase;
-//he just detected one of the base tags
-if (headedToBaseOverwriteAll) {
-headedToBaseOverwriteAll = false;
-giveControlToDropOffController = true;
-}
+//he just detected one of the base tags. hands over to the dropoff
+//controller if we are carrying a cube
+stateMachine.fire(MissionStateMachine::BASE_SEEN);
 }
 
 /*************************
@@ -1053,6 +1373,11 @@ void targetHandler(const apriltags_ros::AprilTagDetectionArray::ConstPtr& messag
     if (currentMode == 1 || currentMode == 0)
         return;
 
+    refreshPoses();
+
+    // the run is queued behind this callback so it sees whatever we decide here
+    stateMachineTrigger.trigger(LoopTrigger::TARGET, message->detections.empty() ? ros::Time::now() : message->detections[0].pose.header.stamp);
+
     //if any tag is detected (this is always true right? lol)
     if (message->detections.size() > 0) 
 {
@@ -1061,12 +1386,17 @@ bool centerSeen = false;
 
         int countRight = 0;
         int countLeft = 0;
+        geometry_msgs::Point nestTags; // mean camera position of the nest tags
 
         // this loop is to get the number of center tags
         for (int i = 0; i < message->detections.size(); i++) {
             if (message->detections[i].id == 256) {
                 geometry_msgs::PoseStamped cenPose = message->detections[i].pose;
 
+                nestTags.x += cenPose.pose.position.x;
+                nestTags.y += cenPose.pose.position.y;
+                nestTags.z += cenPose.pose.position.z;
+
                 // checks if tag is on the right or left side of the image
                 if (cenPose.pose.position.x + cameraOffsetCorrection > 0) {
                     countRight++;//i like this 
@@ -1083,13 +1413,20 @@ bool centerSeen = false;
 //dropoff tag stuff
 if (countLeft > 0 || countRight > 0)
 {
+int nestTagCount = countLeft + countRight;
+nestTags.x /= nestTagCount;
+nestTags.y /= nestTagCount;
+nestTags.z /= nestTagCount;
+nestEstimator->addSighting(currentLocation, nestTags);
+anchorArenaFrame();
+
 dropOffController.setDataTargets(countLeft,countRight);//has the number of left and right 256 tags (the base tags)
 
-        if (centerSeen && headedToBaseOverwriteAll)
+        if (centerSeen)
 		doHitTheBaseCode();
 
 	//to avoid the center blocks if they are considered an obstacle
-	if (!giveControlToDropOffController)
+	if (!stateMachine.isIn(MissionStateMachine::DROPPING_OFF))
 		driveOnTimer(0.05,0.55,1);
 	
 	continueInterruptedSearch();
@@ -1097,7 +1434,7 @@ dropOffController.setDataTargets(countLeft,countRight);//has the number of left
 
 	//note that cubes inside or around the base should not be grabbed
 
-        resetPickUpController();//cos you dont want to pick up cubes inside or around the base
+        stateMachine.fire(MissionStateMachine::PICKUP_ABORTED);//cos you dont want to pick up cubes inside or around the base
         return;
 }//end if dropoff code
         }//end if more than 0 tags (base or cube) are detected
@@ -1106,24 +1443,23 @@ dropOffController.setDataTargets(countLeft,countRight);//has the number of left
 	//start of pickup code
 
     PickUpResult result;
-    if (message->detections.size() > 0 && !giveControlToDropOffController && !headedToBaseOverwriteAll) {
-if (!giveControlToPickupController)
-	print("GIVING CONTROL TO PICKUP CONTROLLER");
-
-result = pickUpController.selectTarget(message);
-if (!giveControlToPickupController)
+    if (message->detections.size() > 0 && stateMachine.isIn(MissionStateMachine::FORAGING)) {
+result = pickUpController.selectTarget(message, currentLocation);
+if (!stateMachine.isIn(MissionStateMachine::PICKING_UP))
 {
+//another rover already called every cube in view, leave them alone
+if (result.allClaimed || !targetClaims->claim(result.targetX, result.targetY))
+	return;
+
+print("GIVING CONTROL TO PICKUP CONTROLLER");
+
 if (result.foundACluster == true)
 {
-searchController.comeBackToCluster = true;
-searchController.clusterLocation.x = currentLocation.x + 0.5*cos(currentLocation.theta);
-searchController.clusterLocation.y = currentLocation.y + 0.5*sin(currentLocation.theta);
-
+//remember where the pile is, at the closest cube
+searchController.clusters.report(result.targetX, result.targetY, result.targetCount);
 }
-else
-searchController.comeBackToCluster = false;
 }
-if (!giveControlToPickupController)//this code runs once per "state change"
+if (!stateMachine.isIn(MissionStateMachine::PICKING_UP))//this code runs once per "state change"
 {
 	//because sometimes its still avoiding an obstacle or something but then it sees the block and it forgets to fix the angle after it finishes doing drive on timer
 	isDoingDriveOnTimer = false;
@@ -1132,9 +1468,11 @@ if (!giveControlToPickupController)//this code runs once per "state change"
 	pickUpController.setDistanceToBlockUponFirstSight(result.blockDist,result.blockYawError);
 	//corrects the angle, first, inside of mobility.cpp in the pickup area.
 	pickUpController.correctAngleBearingToPickUpCube = currentLocation.theta - result.blockYawError;
+	//and from here on the tracker follows this cube
+	pickUpController.beginPickUp();
 }
 
-if (!giveControlToPickupController)
+if (!stateMachine.isIn(MissionStateMachine::PICKING_UP))
 {
 	std_msgs::Float32 fingerAngle;
 	std_msgs::Float32 wristAngle;
@@ -1149,8 +1487,8 @@ if (!giveControlToPickupController)
 		    wristAnglePublish.publish(wristAngle);
                 }
 }
-//true = true = true = true until its not
-giveControlToPickupController = true;
+//stays in PICKING_UP until the pickup is done or aborted
+stateMachine.fire(MissionStateMachine::TARGET_SELECTED);
 
     }//end of found at least 1 cube tag
 }//end targetHandler callback
@@ -1170,7 +1508,16 @@ void obstacleHandler(const std_msgs::UInt8::ConstPtr& message) {
 
 if (! (currentMode == 2 || currentMode == 3)) return; //its in manual mode so dont move it pls
 
-    if (message->data > 0) {
+    //the search steers around it by itself, as long as the grid also has
+    //straight ahead blocked and a way around. when the grid still has it free
+    //(the sonar filter blocks sooner than the grid fills), steer() would keep
+    //us going straight, so the turn below is still needed
+    float freeDirection;
+    bool steeringAround = vfhSteering && stateMachine.getState() == MissionStateMachine::SEARCHING
+        && searchController.getState() == SearchController::MOVING_TO_GOAL && sonarHistogram->steer(0, freeDirection)
+        && freeDirection != 0;
+
+    if (message->data > 0 && !steeringAround) {
 
 
 
@@ -1180,7 +1527,7 @@ if (! (currentMode == 2 || currentMode == 3)) return; //its in manual mode so do
 
 print("obstacle on right ");
             // select new heading 0.2 radians to the left
-if (!isDoingDriveOnTimer && !headedToBaseOverwriteAll && !giveControlToPickupController && !giveControlToDropOffController)	//because the cube blocks the sensor    
+if (!isDoingDriveOnTimer && stateMachine.getState() == MissionStateMachine::SEARCHING)	//because the cube blocks the sensor    
 {
 //print("obstacle on right. turning left");
 driveOnTimer(0.05,0.55,1.0);
@@ -1194,7 +1541,7 @@ print("obstacle on left");
 
 
             // select new heading 0.2 radians to the right
-if (!isDoingDriveOnTimer && !headedToBaseOverwriteAll && !giveControlToPickupController && !giveControlToDropOffController)//because the cube blocks the sensor
+if (!isDoingDriveOnTimer && stateMachine.getState() == MissionStateMachine::SEARCHING)//because the cube blocks the sensor
 {
 //print("obstacle on left. turning right");
 driveOnTimer(0.05,0.55,1.0);
@@ -1209,32 +1556,51 @@ driveOnTimer(0.05,0.55,1.0);
     if (message->data == 4) {
         pickUpController.blockBlock = true;
     }
+
+    // obstacle messages carry no stamp, count from now
+    stateMachineTrigger.trigger(LoopTrigger::OBSTACLE, ros::Time::now());
 }
 
+// runs on a pose spinner thread
 void odometryHandler(const nav_msgs::Odometry::ConstPtr& message) {
+    geometry_msgs::Pose2D location;
+
     //Get (x,y) location directly from pose
-    currentLocation.x = message->pose.pose.position.x;
-    currentLocation.y = message->pose.pose.position.y;
+    location.x = message->pose.pose.position.x;
+    location.y = message->pose.pose.position.y;
 
     //Get theta rotation by converting quaternion orientation to pitch/roll/yaw
     tf::Quaternion q(message->pose.pose.orientation.x, message->pose.pose.orientation.y, message->pose.pose.orientation.z, message->pose.pose.orientation.w);
     tf::Matrix3x3 m(q);
     double roll, pitch, yaw;
     m.getRPY(roll, pitch, yaw);
-    currentLocation.theta = yaw;
+    location.theta = yaw;
+
+    odometrySnapshot.write(location, message->header.stamp);
+    stateMachineTrigger.trigger(LoopTrigger::ODOMETRY, message->header.stamp);
 }
 
+// runs on a pose spinner thread
 void mapHandler(const nav_msgs::Odometry::ConstPtr& message) {
+    geometry_msgs::Pose2D location;
+
     //Get (x,y) location directly from pose
-    currentLocationMap.x = message->pose.pose.position.x;
-    currentLocationMap.y = message->pose.pose.position.y;
+    location.x = message->pose.pose.position.x;
+    location.y = message->pose.pose.position.y;
 
     //Get theta rotation by converting quaternion orientation to pitch/roll/yaw
     tf::Quaternion q(message->pose.pose.orientation.x, message->pose.pose.orientation.y, message->pose.pose.orientation.z, message->pose.pose.orientation.w);
     tf::Matrix3x3 m(q);
     double roll, pitch, yaw;
     m.getRPY(roll, pitch, yaw);
-    currentLocationMap.theta = yaw;
+    location.theta = yaw;
+
+    mapSnapshot.write(location, message->header.stamp);
+}
+
+void refreshPoses() {
+    currentLocation = odometrySnapshot.read(&currentLocationStamp);
+    currentLocationMap = mapSnapshot.read(&currentLocationMapStamp);
 }
 
 void joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message) {
@@ -1249,47 +1615,58 @@ void publishStatusTimerEventHandler(const ros::TimerEvent&) {
     std_msgs::String msg;
     msg.data = "online";
     status_publisher.publish(msg);
-}
-
 
+    // the nest estimate's error grows between sightings, so does the frame's
+    anchorArenaFrame();
 
+    // keep our claim on the cube we are working on alive
+    if (stateMachine.isIn(MissionStateMachine::PICKING_UP)) {
+        targetClaims->renew();
+    }
 
-void sigintEventHandler(int sig) {
-    // All the default sigint handler does is call shutdown()
-    ros::shutdown();
-}
+    // and our place in line at the nest
+    if (stateMachine.isIn(MissionStateMachine::HOMEWARD)) {
+        nestAccess->renew(currentLocation.x, currentLocation.y, nestEta());
+    }
 
-void mapAverage() {
-    // store currentLocation in the averaging array
-    mapLocation[mapCount] = currentLocationMap;
-    mapCount++;
+    // how long the loop takes to react, per kind of trigger
+    std_msgs::Float32MultiArray latencies;
+    stateMachineTrigger.takeLatencies(latencies);
+    loopLatencyPublish.publish(latencies);
 
-    if (mapCount >= mapHistorySize) {
-        mapCount = 0;
-    }
+    // where the time went, per state
+    std_msgs::Float32MultiArray dwell;
+    stateMachine.getDwellHistogram(dwell);
+    stateDwellPublish.publish(dwell);
 
-    double x = 0;
-    double y = 0;
-    double theta = 0;
+    // the pickup and drop off phases since last time, and their histograms
+    phaseTelemetry->flush();
 
-    // add up all the positions in the array
-    for (int i = 0; i < mapHistorySize; i++) {
-        x += mapLocation[i].x;
-        y += mapLocation[i].y;
-        theta += mapLocation[i].theta;
+    // pick up changes to the averaging window made with rosparam set
+    int historySize = mapHistorySize;
+    if (ros::param::getCached("~mapHistorySize", historySize) && historySize != mapHistorySize && historySize > 0) {
+        mapHistorySize = historySize;
+        mapLocationAverage.setWindowSize(mapHistorySize);
     }
+}
 
-    // find the average
-    x = x/mapHistorySize;
-    y = y/mapHistorySize;
-    
-    // Get theta rotation by converting quaternion orientation to pitch/roll/yaw
-    theta = theta/100;
-    currentLocationAverage.x = x;
-    currentLocationAverage.y = y;
-    currentLocationAverage.theta = theta;
 
 
-    
+
+void sigintEventHandler(int sig) {
+    // All the default sigint handler does is call shutdown()
+    ros::shutdown();
 }
 
+void mapAverage() {
+    // store currentLocation in the averaging window; the sums are kept up to
+    // date as samples come and go so this does not depend on the window size.
+    // Only new map fixes go in, so the window spans the same stretch of time
+    // however often the loop runs.
+    static ros::Time lastAveragedStamp;
+    if (currentLocationMapStamp == lastAveragedStamp) return;
+    lastAveragedStamp = currentLocationMapStamp;
+
+    mapLocationAverage.add(currentLocationMap);
+    currentLocationAverage = mapLocationAverage.getAverage();
+}
@@ -0,0 +1,115 @@
+// Times the AngleMath helpers against the while loops they replaced in the
+// pickup controller and the search heading error, on a batch of headings
+// spread over a few turns either way as odometry reports them, then on one
+// corrupted heading of 1e7 that the loops have to walk down a turn at a time.
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include "AngleMath.h"
+
+namespace {
+
+const double twopi = 2 * 3.1415926535;
+const double pi = twopi / 2;
+
+// the pickup controller's FIXING_CAMERA yaw error before AngleMath
+double loopDifference(double myAngle, double goodAngle) {
+  while (myAngle < 0)
+    myAngle = myAngle + twopi;
+  while (myAngle > twopi)
+    myAngle = myAngle - twopi;
+  while (goodAngle < 0)
+    goodAngle = goodAngle + twopi;
+  while (goodAngle > twopi)
+    goodAngle = goodAngle - twopi;
+
+  double error = myAngle - goodAngle;
+  if (error < 0) {
+    while (error < -pi)
+      error = error + twopi;
+  } else if (error > 0) {
+    while (error > pi)
+      error = error - twopi;
+  }
+  return error;
+}
+
+double loopWrap(double angle) {
+  while (angle < -pi)
+    angle = angle + twopi;
+  while (angle > pi)
+    angle = angle - twopi;
+  return angle;
+}
+
+double seconds(clock_t start) {
+  return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int passes = argc > 1 ? atoi(argv[1]) : 200;
+  if (passes < 1) passes = 1;
+
+  const int count = 100000;
+  std::vector<double> to(count), from(count), result(count), work(count);
+  srand(1);
+  for (int i = 0; i < count; i++) {
+    to[i] = (rand() / (double)RAND_MAX - 0.5) * 8 * M_PI;
+    from[i] = (rand() / (double)RAND_MAX - 0.5) * 8 * M_PI;
+  }
+
+  // the checksum keeps the compiler from dropping the loops
+  double checksum = 0;
+  clock_t start = clock();
+  for (int p = 0; p < passes; p++) {
+    for (int i = 0; i < count; i++) result[i] = loopDifference(to[i], from[i]);
+    checksum += result[p % count];
+  }
+  double loopDifferenceSeconds = seconds(start);
+
+  start = clock();
+  for (int p = 0; p < passes; p++) {
+    angle_math::difference(&to[0], &from[0], &result[0], count);
+    checksum += result[p % count];
+  }
+  double batchDifferenceSeconds = seconds(start);
+
+  start = clock();
+  for (int p = 0; p < passes; p++) {
+    for (int i = 0; i < count; i++) result[i] = loopWrap(to[i]);
+    checksum += result[p % count];
+  }
+  double loopWrapSeconds = seconds(start);
+
+  start = clock();
+  for (int p = 0; p < passes; p++) {
+    work = to;
+    angle_math::wrap(&work[0], count);
+    checksum += work[p % count];
+  }
+  double batchWrapSeconds = seconds(start);
+
+  start = clock();
+  for (int p = 0; p < passes; p++) checksum += angle_math::circularMean(&to[0], count);
+  double meanSeconds = seconds(start);
+
+  double millions = double(count) * passes / 1e6;
+  printf("%d headings, %d passes\n", count, passes);
+  printf("difference: loops %.1f, batched %.1f million/s\n", millions / loopDifferenceSeconds, millions / batchDifferenceSeconds);
+  printf("wrap:       loops %.1f, batched %.1f million/s\n", millions / loopWrapSeconds, millions / batchWrapSeconds);
+  printf("circularMean: %.1f million angles/s\n", millions / meanSeconds);
+
+  start = clock();
+  checksum += loopWrap(1e7);
+  double hugeLoopSeconds = seconds(start);
+  start = clock();
+  checksum += angle_math::wrap(1e7);
+  double hugeSeconds = seconds(start);
+  printf("one heading of 1e7: loops %.6f s, wrap %.6f s\n", hugeLoopSeconds, hugeSeconds);
+
+  printf("(checksum %g)\n", checksum);
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "AngleMath.h"
+
+using namespace angle_math;
+
+TEST(AngleMath, WrapKeepsHalfOpenRange) {
+  EXPECT_DOUBLE_EQ(-M_PI, wrap(M_PI));
+  EXPECT_DOUBLE_EQ(-M_PI, wrap(-M_PI));
+  EXPECT_DOUBLE_EQ(-M_PI, wrap(3 * M_PI));
+  EXPECT_NEAR(M_PI - 1e-9, wrap(-M_PI - 1e-9), 1e-12);
+  EXPECT_NEAR(M_PI - 1e-9, wrap(M_PI - 1e-9), 1e-12);
+  EXPECT_DOUBLE_EQ(0, wrap(0));
+  EXPECT_NEAR(0.5, wrap(0.5 + 4 * twoPi), 1e-12);
+  EXPECT_NEAR(-0.5, wrap(-0.5 - 4 * twoPi), 1e-12);
+}
+
+TEST(AngleMath, WrapPositiveKeepsHalfOpenRange) {
+  EXPECT_DOUBLE_EQ(0, wrapPositive(0));
+  EXPECT_DOUBLE_EQ(0, wrapPositive(twoPi));
+  EXPECT_DOUBLE_EQ(M_PI, wrapPositive(-M_PI));
+  EXPECT_NEAR(twoPi - 1e-9, wrapPositive(-1e-9), 1e-12);
+}
+
+TEST(AngleMath, DifferenceTakesTheShortWay) {
+  EXPECT_NEAR(0.2, difference(-M_PI + 0.1, M_PI - 0.1), 1e-12);
+  EXPECT_NEAR(-0.2, difference(M_PI - 0.1, -M_PI + 0.1), 1e-12);
+  EXPECT_NEAR(-M_PI / 2, difference(0, M_PI / 2), 1e-12);
+}
+
+// a heading from corrupted odometry: the loops this replaced would spin for
+// hundreds of millions of turns
+TEST(AngleMath, HugeInputsWrapWithoutLooping) {
+  const double huge[] = {1e6, -1e6, 1e9, -1e9, 1e12, -1e12};
+  for (int i = 0; i < 6; i++) {
+    double wrapped = wrap(huge[i]);
+    // what is left of the angle is only good to about its last bit
+    double slack = 4 * ldexp(1.0, ilogb(huge[i]) - 52);
+    EXPECT_GE(wrapped, -M_PI - slack) << huge[i];
+    EXPECT_LE(wrapped, M_PI + slack) << huge[i];
+    EXPECT_NEAR(remainder(huge[i], twoPi), wrapped, slack) << huge[i];
+  }
+}
+
+TEST(AngleMath, NaNPassesThrough) {
+  EXPECT_TRUE(std::isnan(wrap(NAN)));
+  EXPECT_TRUE(std::isnan(wrapPositive(NAN)));
+  EXPECT_TRUE(std::isnan(difference(NAN, 1)));
+  EXPECT_TRUE(std::isnan(difference(1, NAN)));
+  EXPECT_TRUE(std::isnan(wrap(INFINITY)));
+}
+
+TEST(AngleMath, BatchedMatchesScalar) {
+  double angles[] = {-7, -M_PI, -1, 0, 1, M_PI, 7, 1e9, NAN};
+  double from[] = {1, 2, 3, -3, -2, -1, 0, 1e9, 0};
+  const int count = sizeof(angles) / sizeof(angles[0]);
+
+  double differences[count];
+  difference(angles, from, differences, count);
+  for (int i = 0; i < count - 1; i++) EXPECT_EQ(difference(angles[i], from[i]), differences[i]) << i;
+  EXPECT_TRUE(std::isnan(differences[count - 1]));
+
+  double wrapped[count];
+  for (int i = 0; i < count; i++) wrapped[i] = angles[i];
+  wrap(wrapped, count);
+  for (int i = 0; i < count - 1; i++) EXPECT_EQ(wrap(angles[i]), wrapped[i]) << i;
+  EXPECT_TRUE(std::isnan(wrapped[count - 1]));
+}
+
+TEST(AngleMath, CircularMeanAcrossTheSeam) {
+  // 0.1 either side of 0 written as 0.1 and 2pi - 0.1
+  const double nearZero[] = {0.1, twoPi - 0.1};
+  EXPECT_NEAR(0, circularMean(nearZero, 2), 1e-12);
+
+  // either side of pi, where the plain average is 0
+  const double nearPi[] = {M_PI - 0.1, -M_PI + 0.1};
+  EXPECT_NEAR(0, difference(circularMean(nearPi, 2), M_PI), 1e-12);
+
+  const double skewed[] = {-0.2, twoPi + 0.1, 0.4};
+  EXPECT_NEAR(0.1, circularMean(skewed, 3), 1e-12);
+
+  const double one[] = {5 * M_PI / 2};
+  EXPECT_NEAR(M_PI / 2, circularMean(one, 1), 1e-12);
+
+  EXPECT_EQ(0, circularMean(one, 0));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,47 @@
+#include "SonarFilter.h"
+
+SonarFilter::SonarFilter() {
+  count = 0;
+  next = 0;
+  median = 0;
+  blocked = false;
+  changingSince = -1;
+}
+
+void SonarFilter::setSettings(const Settings& settings) {
+  this->settings = settings;
+  if (this->settings.window < 1) this->settings.window = 1;
+  if (this->settings.window > maxWindow) this->settings.window = maxWindow;
+  if (this->settings.clearDistance < this->settings.nearDistance) this->settings.clearDistance = this->settings.nearDistance;
+
+  count = 0;
+  next = 0;
+}
+
+float SonarFilter::update(float range, double now) {
+  readings[next] = range;
+  next = (next + 1) % settings.window;
+  if (count < settings.window) count++;
+
+  // insertion sort of a copy, the window is only a handful of readings
+  float sorted[maxWindow];
+  for (int i = 0; i < count; i++) {
+    int j = i;
+    for (; j > 0 && sorted[j - 1] > readings[i]; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = readings[i];
+  }
+  median = sorted[count / 2];
+
+  bool changing = blocked ? median > settings.clearDistance : median < settings.nearDistance;
+  if (!changing) {
+    changingSince = -1;
+  } else {
+    if (changingSince < 0) changingSince = now;
+    if (now - changingSince >= (blocked ? settings.clearDebounce : settings.debounce)) {
+      blocked = !blocked;
+      changingSince = -1;
+    }
+  }
+
+  return median;
+}
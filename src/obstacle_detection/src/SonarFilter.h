@@ -0,0 +1,53 @@
+#ifndef SONAR_FILTER_H
+#define SONAR_FILTER_H
+
+/**
+ * Cleans up one sonar. The range is the median of the last window readings,
+ * which throws out the odd echo without smearing a real edge the way an
+ * average would. Whether the sonar sees an obstacle has hysteresis: the
+ * median has to come within nearDistance to block and go past clearDistance
+ * to clear, so a wall right at the threshold does not flicker. Blocking also
+ * waits debounce seconds of near readings, and clearing clearDebounce seconds
+ * of far ones.
+ */
+class SonarFilter {
+
+  public:
+
+    struct Settings {
+      int window;
+      float nearDistance;
+      float clearDistance;
+      float debounce;
+      float clearDebounce;
+
+      Settings() : window(5), nearDistance(0.60), clearDistance(0.70), debounce(0.2), clearDebounce(0) {}
+    };
+
+    static const int maxWindow = 15;
+
+    SonarFilter();
+
+    void setSettings(const Settings& settings);
+
+    // adds a reading taken at now (seconds) and returns the filtered range
+    float update(float range, double now);
+
+    float getRange() {return median;}
+    bool isBlocked() {return blocked;}
+
+  private:
+
+    Settings settings;
+
+    float readings[maxWindow];
+    int count;
+    int next;
+    float median;
+
+    bool blocked;
+    // when the readings started disagreeing with blocked, negative if they agree
+    double changingSince;
+};
+
+#endif /* SONAR_FILTER_H */
@@ -0,0 +1,134 @@
+#include "SonarGrid.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// certainty added at the measured range, and taken off in front of it
+const int hitIncrement = 3;
+const int missDecrement = 1;
+
+// the rays cast across a cone
+const int maxRays = 15;
+
+double wrapPositive(double angle) {
+  return angle - 2 * M_PI * floor(angle / (2 * M_PI));
+}
+
+} // namespace
+
+SonarGrid::SonarGrid(int size, float cellSize, int sectors) {
+  this->size = size > 2 ? size : 2;
+  this->cellSize = cellSize > 0 ? cellSize : 0.1;
+  this->sectors = sectors > 0 ? sectors : 1;
+  cells.assign(this->size * this->size, 0);
+  originX = -this->size / 2;
+  originY = -this->size / 2;
+  x = 0;
+  y = 0;
+  yaw = 0;
+}
+
+uint8_t& SonarGrid::cell(int ix, int iy) {
+  int column = ((ix % size) + size) % size;
+  int row = ((iy % size) + size) % size;
+  return cells[column * size + row];
+}
+
+void SonarGrid::recenter(int cx, int cy) {
+  int newOriginX = cx - size / 2;
+  int newOriginY = cy - size / 2;
+
+  if (abs(newOriginX - originX) >= size || abs(newOriginY - originY) >= size) {
+    cells.assign(size * size, 0);
+  } else {
+    // columns and rows that wrapped around from the far side hold old cells
+    int from = newOriginX > originX ? originX + size : newOriginX;
+    int to = newOriginX > originX ? newOriginX + size : originX;
+    for (int ix = from; ix < to; ix++) {
+      for (int row = 0; row < size; row++) cell(ix, row) = 0;
+    }
+
+    from = newOriginY > originY ? originY + size : newOriginY;
+    to = newOriginY > originY ? newOriginY + size : originY;
+    for (int iy = from; iy < to; iy++) {
+      for (int column = 0; column < size; column++) cell(column, iy) = 0;
+    }
+  }
+
+  originX = newOriginX;
+  originY = newOriginY;
+}
+
+void SonarGrid::setPose(float x, float y, float yaw) {
+  this->x = x;
+  this->y = y;
+  this->yaw = yaw;
+
+  int cx = (int)floor(x / cellSize);
+  int cy = (int)floor(y / cellSize);
+  if (cx - size / 2 != originX || cy - size / 2 != originY) recenter(cx, cy);
+}
+
+void SonarGrid::addReading(const Sonar& sonar, float range) {
+  if (!(range > 0)) return;
+
+  float sensorX = x + cos(yaw) * sonar.x - sin(yaw) * sonar.y;
+  float sensorY = y + sin(yaw) * sonar.x + cos(yaw) * sonar.y;
+  float heading = yaw + sonar.yaw;
+  bool hit = range < sonar.maxRange;
+  float freeRange = (hit ? range : sonar.maxRange) - cellSize;
+
+  // enough rays that neighbouring ones are at most a cell apart at the range
+  int rays = (int)ceil(2 * sonar.halfWidth * range / cellSize) + 1;
+  if (rays < 3) rays = 3;
+  if (rays > maxRays) rays = maxRays;
+
+  for (int r = 0; r < rays; r++) {
+    float angle = heading - sonar.halfWidth + 2 * sonar.halfWidth * r / (rays - 1);
+    float dx = cos(angle);
+    float dy = sin(angle);
+
+    for (float t = 0; t < freeRange; t += cellSize) {
+      int ix = (int)floor((sensorX + dx * t) / cellSize);
+      int iy = (int)floor((sensorY + dy * t) / cellSize);
+      if (ix < originX || ix >= originX + size || iy < originY || iy >= originY + size) break;
+      uint8_t& c = cell(ix, iy);
+      c = c > missDecrement ? c - missDecrement : 0;
+    }
+
+    if (hit) {
+      int ix = (int)floor((sensorX + dx * range) / cellSize);
+      int iy = (int)floor((sensorY + dy * range) / cellSize);
+      if (ix < originX || ix >= originX + size || iy < originY || iy >= originY + size) continue;
+      uint8_t& c = cell(ix, iy);
+      c = c + hitIncrement < maxCertainty ? c + hitIncrement : maxCertainty;
+    }
+  }
+}
+
+void SonarGrid::getHistogram(std::vector<uint8_t>& histogram) {
+  float radius = size / 2 * cellSize;
+  float sectorWidth = 2 * M_PI / sectors;
+  std::vector<float> weights(sectors, 0);
+
+  for (int ix = originX; ix < originX + size; ix++) {
+    for (int iy = originY; iy < originY + size; iy++) {
+      int c = cell(ix, iy);
+      if (c == 0) continue;
+
+      float dx = (ix + 0.5) * cellSize - x;
+      float dy = (iy + 0.5) * cellSize - y;
+      float distance = hypot(dx, dy);
+      if (distance >= radius) continue;
+
+      int sector = (int)(wrapPositive(atan2(dy, dx) - yaw + sectorWidth / 2) / sectorWidth) % sectors;
+      weights[sector] += c * c * (1 - distance / radius);
+    }
+  }
+
+  histogram.resize(sectors);
+  for (int i = 0; i < sectors; i++) {
+    histogram[i] = weights[i] < 255 ? (uint8_t)weights[i] : 255;
+  }
+}
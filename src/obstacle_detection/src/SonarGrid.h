@@ -0,0 +1,66 @@
+#ifndef SONAR_GRID_H
+#define SONAR_GRID_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * A small occupancy grid around the rover, built from the sonar cones, and
+ * the free direction histogram of a vector field histogram (VFH) on top.
+ *
+ * The grid is size by size cells in the odometry frame and rolls along with
+ * the rover: cells are addressed by their odometry cell index modulo size, so
+ * moving only clears the rows and columns that come into view. Each cell
+ * holds a certainty from 0 to maxCertainty. A sonar reading raises the cells
+ * on the arc at the measured range and lowers the ones in the cone before it.
+ *
+ * The histogram splits the circle around the rover into sectors, sector 0
+ * straight ahead and counting counterclockwise. Each occupied cell adds
+ * certainty^2 * (1 - distance / radius) to its sector, so close, often seen
+ * cells weigh the most. Sectors are scaled to 0-255 for the message.
+ */
+class SonarGrid {
+
+  public:
+
+    struct Sonar {
+      float x;      // position on the rover, meters forward and left
+      float y;
+      float yaw;    // pointing, radians left of straight ahead
+      float halfWidth; // half the cone angle
+      float maxRange;
+    };
+
+    static const int maxCertainty = 15;
+
+    SonarGrid(int size, float cellSize, int sectors);
+
+    // rover pose in odom, before the readings taken there
+    void setPose(float x, float y, float yaw);
+
+    void addReading(const Sonar& sonar, float range);
+
+    // sector weights, relative to the rover's heading
+    void getHistogram(std::vector<uint8_t>& histogram);
+
+  private:
+
+    uint8_t& cell(int ix, int iy);
+    // moves the window so it is centered on odom cell (cx, cy)
+    void recenter(int cx, int cy);
+
+    int size;
+    float cellSize;
+    int sectors;
+
+    std::vector<uint8_t> cells;
+    // odom cell index of the window's lower left corner
+    int originX;
+    int originY;
+
+    float x;
+    float y;
+    float yaw;
+};
+
+#endif /* SONAR_GRID_H */
@@ -7,20 +7,78 @@
 
 //ROS messages
 #include <std_msgs/UInt8.h>
+#include <std_msgs/Float32MultiArray.h>
+#include <std_msgs/UInt8MultiArray.h>
 #include <sensor_msgs/Range.h>
+#include <nav_msgs/Odometry.h>
+
+#include "SonarFilter.h"
+#include "SonarGrid.h"
 
 using namespace std;
 
 //Globals
-double collisionDistance = 0.60; //meters the ultrasonic detectors will flag obstacles
 string publishedName;
 char host[128];
 
+//left, center, right
+SonarFilter sonarFilters[3];
+const char* sonarNames[] = {"left", "center", "right"};
+double blockDistance = 0.12; //meters, a cube right in front of the center sonar
+
+//latest reading of each sonar. Unless ~syncSonars is set, the sonars are not
+//synchronized: every reading is evaluated as it arrives, together with the
+//latest of the other two, and a sonar that has gone quiet for
+//~sonarStaleAge seconds is left out and flagged instead of holding up the rest
+struct SonarReading {
+	float range;
+	float rawRange; //unfiltered, for the cube in the claw
+	bool hasReading; //a sonar that has never reported counts as stale
+	ros::Time stamp;
+	double received;
+};
+SonarReading latestReadings[3];
+double sonarStaleAge = 0.5;
+bool staleFlags[3];
+
+//sonar stamp to obstacle message, reported once a second
+struct LatencyStats {
+	int runs;
+	double sum;
+	double max;
+};
+LatencyStats obstacleLatency;
+
+//where the sonars see things around the rover, for steering around them
+SonarGrid* sonarGrid;
+SonarGrid::Sonar sonarMounts[3];
+bool haveOdometry = false;
+
 //Publishers
 ros::Publisher obstaclePublish;
+ros::Publisher sonarFilteredPublish;
+ros::Publisher sonarHistogramPublish;
+ros::Publisher sonarStalePublish;
+ros::Publisher obstacleLatencyPublish;
+
+//Subscribers
+ros::Subscriber odometrySubscriber;
+ros::Subscriber sonarLeftSubscriber;
+ros::Subscriber sonarCenterSubscriber;
+ros::Subscriber sonarRightSubscriber;
+
+ros::Timer latencyTimer;
 
 //Callback handlers
 void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight);
+void sonarLeftHandler(const sensor_msgs::Range::ConstPtr& message);
+void sonarCenterHandler(const sensor_msgs::Range::ConstPtr& message);
+void sonarRightHandler(const sensor_msgs::Range::ConstPtr& message);
+void odometryHandler(const nav_msgs::Odometry::ConstPtr& message);
+void latencyTimerEventHandler(const ros::TimerEvent& event);
+
+void sonarArrived(int sonar, const sensor_msgs::Range::ConstPtr& message);
+void evaluateSonars(bool placeAll, int arrived);
 
 int main(int argc, char** argv) {
     gethostname(host, sizeof (host));
@@ -36,82 +94,207 @@ int main(int argc, char** argv) {
 
     ros::init(argc, argv, (publishedName + "_OBSTACLE"));
     ros::NodeHandle oNH;
-    
+
+    // filter settings for all sonars, and then per sonar, e.g. ~center/debounce
+    ros::NodeHandle param("~");
+    SonarFilter::Settings defaults;
+    param.param("window", defaults.window, defaults.window);
+    param.param("collisionDistance", defaults.nearDistance, defaults.nearDistance);
+    param.param("clearDistance", defaults.clearDistance, defaults.clearDistance);
+    param.param("debounce", defaults.debounce, defaults.debounce);
+    param.param("clearDebounce", defaults.clearDebounce, defaults.clearDebounce);
+    param.param("blockDistance", blockDistance, blockDistance);
+    for (int i = 0; i < 3; i++) {
+        ros::NodeHandle sonarParam(param, sonarNames[i]);
+        SonarFilter::Settings settings = defaults;
+        sonarParam.param("window", settings.window, settings.window);
+        sonarParam.param("collisionDistance", settings.nearDistance, settings.nearDistance);
+        sonarParam.param("clearDistance", settings.clearDistance, settings.clearDistance);
+        sonarParam.param("debounce", settings.debounce, settings.debounce);
+        sonarParam.param("clearDebounce", settings.clearDebounce, settings.clearDebounce);
+        sonarFilters[i].setSettings(settings);
+    }
+
+    // occupancy grid and histogram; the sonars sit 15cm forward, the side
+    // ones 7cm out and turned 25 degrees
+    int gridSize = 40;
+    double gridCellSize = 0.1;
+    int histogramSectors = 36;
+    double sonarHalfWidth = 0.25;
+    double sonarMaxRange = 3.0;
+    param.param("gridSize", gridSize, gridSize);
+    param.param("gridCellSize", gridCellSize, gridCellSize);
+    param.param("histogramSectors", histogramSectors, histogramSectors);
+    param.param("sonarHalfWidth", sonarHalfWidth, sonarHalfWidth);
+    param.param("sonarMaxRange", sonarMaxRange, sonarMaxRange);
+    sonarGrid = new SonarGrid(gridSize, gridCellSize, histogramSectors);
+    float mountY[] = {0.07, 0, -0.07};
+    float mountYaw[] = {0.436, 0, -0.436};
+    for (int i = 0; i < 3; i++) {
+        sonarMounts[i].x = 0.15;
+        sonarMounts[i].y = mountY[i];
+        sonarMounts[i].yaw = mountYaw[i];
+        sonarMounts[i].halfWidth = sonarHalfWidth;
+        sonarMounts[i].maxRange = sonarMaxRange;
+    }
+
     obstaclePublish = oNH.advertise<std_msgs::UInt8>((publishedName + "/obstacle"), 10);
-    
-    message_filters::Subscriber<sensor_msgs::Range> sonarLeftSubscriber(oNH, (publishedName + "/sonarLeft"), 10);
-    message_filters::Subscriber<sensor_msgs::Range> sonarCenterSubscriber(oNH, (publishedName + "/sonarCenter"), 10);
-    message_filters::Subscriber<sensor_msgs::Range> sonarRightSubscriber(oNH, (publishedName + "/sonarRight"), 10);
+    sonarFilteredPublish = oNH.advertise<std_msgs::Float32MultiArray>((publishedName + "/sonarFiltered"), 10);
+    sonarHistogramPublish = oNH.advertise<std_msgs::UInt8MultiArray>((publishedName + "/sonarHistogram"), 10);
+    sonarStalePublish = oNH.advertise<std_msgs::UInt8MultiArray>((publishedName + "/sonarStale"), 1, true);
+    obstacleLatencyPublish = oNH.advertise<std_msgs::Float32MultiArray>((publishedName + "/obstacleLatency"), 1, true);
+    odometrySubscriber = oNH.subscribe((publishedName + "/odom/filtered"), 10, odometryHandler);
+    latencyTimer = oNH.createTimer(ros::Duration(1.0), latencyTimerEventHandler);
+
+    bool syncSonars = false;
+    param.param("syncSonars", syncSonars, syncSonars);
+    param.param("sonarStaleAge", sonarStaleAge, sonarStaleAge);
 
-    typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Range, sensor_msgs::Range, sensor_msgs::Range> sonarSyncPolicy;
+    if (syncSonars) {
+        message_filters::Subscriber<sensor_msgs::Range> sonarLeftSyncSubscriber(oNH, (publishedName + "/sonarLeft"), 10);
+        message_filters::Subscriber<sensor_msgs::Range> sonarCenterSyncSubscriber(oNH, (publishedName + "/sonarCenter"), 10);
+        message_filters::Subscriber<sensor_msgs::Range> sonarRightSyncSubscriber(oNH, (publishedName + "/sonarRight"), 10);
 
-    message_filters::Synchronizer<sonarSyncPolicy> sonarSync(sonarSyncPolicy(10), sonarLeftSubscriber, sonarCenterSubscriber, sonarRightSubscriber);
-    sonarSync.registerCallback(boost::bind(&sonarHandler, _1, _2, _3));
+        typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Range, sensor_msgs::Range, sensor_msgs::Range> sonarSyncPolicy;
 
-    ros::spin();
+        message_filters::Synchronizer<sonarSyncPolicy> sonarSync(sonarSyncPolicy(10), sonarLeftSyncSubscriber, sonarCenterSyncSubscriber, sonarRightSyncSubscriber);
+        sonarSync.registerCallback(boost::bind(&sonarHandler, _1, _2, _3));
+
+        ros::spin();
+    } else {
+        sonarLeftSubscriber = oNH.subscribe((publishedName + "/sonarLeft"), 10, sonarLeftHandler);
+        sonarCenterSubscriber = oNH.subscribe((publishedName + "/sonarCenter"), 10, sonarCenterHandler);
+        sonarRightSubscriber = oNH.subscribe((publishedName + "/sonarRight"), 10, sonarRightHandler);
+
+        ros::spin();
+    }
 
     return EXIT_SUCCESS;
 }
 
-/*
-
-ros::Time omniTimerStartingTime;
-ros::Duration timeDifferenceObject = ros::Time::now() - driveOnTimerStartingTime;
-timeDifferenceObject = ros::Time::now() - omniTimerStartingTime;
-if ((timeDifferenceObject.sec + timeDifferenceObject.nsec/1000000000.0) < duration)
-*/
+void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight) {
+sonarArrived(0, sonarLeft);
+sonarArrived(1, sonarCenter);
+sonarArrived(2, sonarRight);
+evaluateSonars(true, 1);
+}
 
-ros::Time timerStartingTimes[3];
-bool isDown[3];
+void sonarLeftHandler(const sensor_msgs::Range::ConstPtr& message) {
+sonarArrived(0, message);
+evaluateSonars(false, 0);
+}
 
+void sonarCenterHandler(const sensor_msgs::Range::ConstPtr& message) {
+sonarArrived(1, message);
+evaluateSonars(false, 1);
+}
 
+void sonarRightHandler(const sensor_msgs::Range::ConstPtr& message) {
+sonarArrived(2, message);
+evaluateSonars(false, 2);
+}
 
+void sonarArrived(int sonar, const sensor_msgs::Range::ConstPtr& message) {
+double now = ros::Time::now().toSec();
+latestReadings[sonar].range = sonarFilters[sonar].update(message->range, now);
+latestReadings[sonar].rawRange = message->range;
+latestReadings[sonar].stamp = message->header.stamp;
+latestReadings[sonar].received = now;
+latestReadings[sonar].hasReading = true;
+}
 
-void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight) {
+//decides on the obstacle code from the latest reading of each sonar. the
+//reading that just arrived (or with placeAll, all three) also goes in the grid
+void evaluateSonars(bool placeAll, int arrived) {
 	std_msgs::UInt8 obstacleMode;
+	obstacleMode.data = 0; //no collision
 
-ros::Time now = ros::Time::now();
-float sonarReadings[] = {sonarLeft->range, sonarCenter->range, sonarRight->range};
+double now = ros::Time::now().toSec();
 float dataToSend[] =    {2,		   2,			1};
+
+std_msgs::Float32MultiArray filtered;
+filtered.data.resize(3);
+bool staleChanged = false;
 int i;
 for (i = 0; i < 3; i++)
 {
-ros::Duration timeDifference = now - timerStartingTimes[i];
-if (sonarReadings[i] > collisionDistance)
-{//reset the time-it-has-been-down
-isDown[i] = false;
-}
-else//its pressed down
-{
-if (isDown[i])
+filtered.data[i] = latestReadings[i].range;
+bool stale = !latestReadings[i].hasReading || now - latestReadings[i].received > sonarStaleAge;
+if (stale != staleFlags[i])
 {
-if (timeDifference.sec + timeDifference.nsec/1000000000.0 > 0.8)//0.5 seconds
+staleFlags[i] = stale;
+staleChanged = true;
+}
+if (!stale && sonarFilters[i].isBlocked())
 {
 //send it
 obstacleMode.data = dataToSend[i];
 }
-}
-else
-{
-timerStartingTimes[i] = now;
-isDown[i] = true;
-}
-
-
-}
-
 }//end for
 
-	
-	if ((sonarLeft->range > collisionDistance) && (sonarCenter->range > collisionDistance) && (sonarRight->range > collisionDistance)) {
-		obstacleMode.data = 0; //no collision
-	}
-	
-	if (sonarCenter->range < 0.12) //block in front of center unltrasound.
+	//the median lags by half its window, too slow to tell the claw closed on a
+	//cube, so that is decided on the raw center reading
+	if (!staleFlags[1] && latestReadings[1].rawRange < blockDistance) //block in front of center unltrasound.
 	{
 		obstacleMode.data = 4;
 	}
 	
         obstaclePublish.publish(obstacleMode);
+        sonarFilteredPublish.publish(filtered);
+
+//how long since the sonar took the reading; unstamped readings count from arrival
+ros::Time stamp = latestReadings[arrived].stamp;
+double latency = stamp.isZero() ? now - latestReadings[arrived].received : now - stamp.toSec();
+obstacleLatency.runs++;
+obstacleLatency.sum += latency;
+if (latency > obstacleLatency.max)
+	obstacleLatency.max = latency;
+
+if (staleChanged)
+{
+std_msgs::UInt8MultiArray stale;
+stale.data.resize(3);
+for (i = 0; i < 3; i++)
+	stale.data[i] = staleFlags[i];
+sonarStalePublish.publish(stale);
 }
 
+//without odometry the readings can not be placed
+if (!haveOdometry)
+	return;
+
+for (i = 0; i < 3; i++)
+	if ((placeAll || i == arrived) && !staleFlags[i])
+		sonarGrid->addReading(sonarMounts[i], filtered.data[i]);
+
+std_msgs::UInt8MultiArray histogram;
+sonarGrid->getHistogram(histogram.data);
+histogram.layout.dim.resize(1);
+histogram.layout.dim[0].label = "sector";
+histogram.layout.dim[0].size = histogram.data.size();
+histogram.layout.dim[0].stride = histogram.data.size();
+sonarHistogramPublish.publish(histogram);
+}
+
+void latencyTimerEventHandler(const ros::TimerEvent&) {
+std_msgs::Float32MultiArray latency;
+latency.layout.dim.resize(1);
+latency.layout.dim[0].label = "runs,meanMs,maxMs";
+latency.layout.dim[0].size = 3;
+latency.layout.dim[0].stride = 3;
+latency.data.push_back(obstacleLatency.runs);
+latency.data.push_back(obstacleLatency.runs > 0 ? 1000 * obstacleLatency.sum / obstacleLatency.runs : 0);
+latency.data.push_back(1000 * obstacleLatency.max);
+obstacleLatencyPublish.publish(latency);
+
+obstacleLatency.runs = 0;
+obstacleLatency.sum = 0;
+obstacleLatency.max = 0;
+}
+
+void odometryHandler(const nav_msgs::Odometry::ConstPtr& message) {
+const geometry_msgs::Quaternion& q = message->pose.pose.orientation;
+float yaw = atan2(2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z));
+sonarGrid->setPose(message->pose.pose.position.x, message->pose.pose.position.y, yaw);
+haveOdometry = true;
+}
@@ -0,0 +1,51 @@
+#ifndef DRIVE_CONTROLLER_H
+#define DRIVE_CONTROLLER_H
+
+#include <ros/ros.h>
+#include "pid_controller/PIDController.h"
+
+/**
+ * The rover drive loop, shared by abridge on the physical rover and sbridge
+ * in the simulation so the two respond to mobility the same way.
+ *
+ * It turns a drive command (linear speed in meters per second and a yaw
+ * error in radians) into left and right motor commands from -255 to 255. In
+ * automatic mode a feed forward table plus a velocity PID on the measured
+ * speed gives the forward part, and a yaw PID the turn. Neither ever drives
+ * against the commanded direction. The controllers run on the measured time
+ * between commands, start afresh when commands stop for a while, and reset
+ * when the speed setpoint changes or the yaw error changes sign. In manual
+ * mode the command is scaled straight to the motors.
+ */
+class DriveController {
+
+  public:
+
+    static const int SATURATION = 255;
+
+    // the default gains
+    DriveController();
+
+    // the default gains, overridden by ~velocityKp, ~velocityKi, ~velocityKd,
+    // ~velocityIntegralDeadband, ~yawKp, ~yawKi, ~yawKd, ~yawIntegralDeadband
+    // and ~derivativeFilter from param
+    DriveController(const ros::NodeHandle& param);
+
+    // the motor commands for a drive command received now, with the rover
+    // moving at measuredSpeed meters per second
+    void update(float linearSpeed, float yawError, float measuredSpeed, bool manual, int& left, int& right);
+
+    void reset();
+
+  private:
+
+    void init(const ros::NodeHandle* param);
+
+    PIDController velocityPID;
+    PIDController yawPID;
+    float prevLin;
+    float prevYaw;
+    ros::Time prevCommandTime;
+};
+
+#endif /* DRIVE_CONTROLLER_H */
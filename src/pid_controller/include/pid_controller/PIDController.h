@@ -0,0 +1,81 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <ros/console.h>
+
+/**
+ * This class defines the base PID controller shared by the joints in the
+ * GripperPlugin and the rover DriveController.
+ *
+ * The controller works on the real time between updates, so the same gains
+ * hold at any control rate. On top of the plain PID it can keep the integral
+ * from winding up while the output is saturated, cap the integral term, leave
+ * small errors out of the integral and low pass filter the derivative. All of
+ * these are off in a default PIDSettings, which is the plain controller the
+ * gripper was tuned with.
+ *
+ * @author Matthew Fricke
+ * @author Antonio Griego
+ */
+class PIDController {
+
+  public:
+
+    // this struct defines all of the key variables for the PID controller and
+    // simplifies passing around the entire series of values between functions
+    struct PIDSettings {
+      float Kp;
+      float Ki;
+      float Kd;
+      float dt;  // update time used by update(setPoint, currentValue)
+      float max;
+      float min;
+
+      bool antiWindup;        // stop integrating while the output is pinned at max or min
+      float integralMax;      // largest magnitude of the integral term, 0 for no cap
+      float integralDeadband; // errors smaller than this are not integrated
+      float derivativeFilter; // time constant in seconds of the derivative low pass, 0 for none
+
+      PIDSettings();
+    };
+
+    // constructors
+    PIDController();
+    PIDController(PIDController::PIDSettings settings);
+
+    // returns a force to apply based on the setPoint vs. currentValue, one
+    // settings.dt after the last update
+    float update(float setPoint, float currentValue);
+
+    // the same, dt seconds after the last update
+    float update(float setPoint, float currentValue, float dt);
+
+    // for callers that measure the error directly
+    float updateError(float error, float dt);
+
+    // forgets the integral and the error history
+    void reset();
+
+  private:
+
+    float dt;  // Update time
+    float max; // Max setpoint
+    float min; // Min setpoint
+    float Kp;  // Proportional gain
+    float Kd;  // Derivative gain
+    float Ki;  // Integral gain
+
+    bool antiWindup;
+    float integralMax;
+    float integralDeadband;
+    float derivativeFilter;
+
+    float previousError; // Previous error, valid when hasPreviousError
+    bool  hasPreviousError;
+    float derivative;    // Filtered rate of change of the error
+    float integral;      // Sum of the error seen so far
+    bool  isInitialized; // PID controller status flag
+
+};
+
+#endif /* PID_CONTROLLER_H */
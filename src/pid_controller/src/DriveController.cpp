@@ -0,0 +1,150 @@
+#include "pid_controller/DriveController.h"
+
+namespace {
+
+const float sat = DriveController::SATURATION;
+const float nominalDriveInterval = 0.1; // mobility's command interval, used when there is no previous command to measure from
+const float maxDriveCommandGap = 0.5;   // commands further apart than this start the PIDs afresh
+
+float clamp(float value, float low, float high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+}
+
+DriveController::DriveController() {
+  init(NULL);
+}
+
+DriveController::DriveController(const ros::NodeHandle& param) {
+  init(&param);
+}
+
+void DriveController::init(const ros::NodeHandle* param) {
+  // Integral gains are per second; the old fixed 10 Hz controller summed
+  // errors per update, so its gains were a tenth of these
+  PIDController::PIDSettings velocitySettings;
+  velocitySettings.Kp = 140;
+  velocitySettings.Ki = 200;
+  velocitySettings.Kd = 30;
+  velocitySettings.integralDeadband = 0.01;
+  velocitySettings.derivativeFilter = 0.1;
+  if (param != NULL) {
+    param->param("velocityKp", velocitySettings.Kp, velocitySettings.Kp);
+    param->param("velocityKi", velocitySettings.Ki, velocitySettings.Ki);
+    param->param("velocityKd", velocitySettings.Kd, velocitySettings.Kd);
+    param->param("velocityIntegralDeadband", velocitySettings.integralDeadband, velocitySettings.integralDeadband);
+    param->param("derivativeFilter", velocitySettings.derivativeFilter, velocitySettings.derivativeFilter);
+  }
+  velocitySettings.dt = nominalDriveInterval;
+  velocitySettings.max = sat;
+  velocitySettings.min = -sat;
+  velocitySettings.antiWindup = true;
+  velocitySettings.integralMax = sat/2;
+  velocityPID = PIDController(velocitySettings);
+
+  PIDController::PIDSettings yawSettings;
+  yawSettings.Kp = 200;
+  yawSettings.Ki = 150;
+  yawSettings.Kd = 30;
+  yawSettings.integralDeadband = 0.1;
+  if (param != NULL) {
+    param->param("yawKp", yawSettings.Kp, yawSettings.Kp);
+    param->param("yawKi", yawSettings.Ki, yawSettings.Ki);
+    param->param("yawKd", yawSettings.Kd, yawSettings.Kd);
+    param->param("yawIntegralDeadband", yawSettings.integralDeadband, yawSettings.integralDeadband);
+  }
+  yawSettings.derivativeFilter = velocitySettings.derivativeFilter;
+  yawSettings.dt = nominalDriveInterval;
+  yawSettings.max = sat/2;
+  yawSettings.min = -sat/2;
+  yawSettings.antiWindup = true;
+  yawSettings.integralMax = sat/2;
+  yawPID = PIDController(yawSettings);
+
+  reset();
+}
+
+/**
+ * Forgets the command history; the next update starts the PIDs afresh.
+ */
+void DriveController::reset() {
+  velocityPID.reset();
+  yawPID.reset();
+  prevLin = 0;
+  prevYaw = 0;
+  prevCommandTime = ros::Time();
+}
+
+/**
+ * See the following paper for description of PID controllers.
+ * Bennett, Stuart (November 1984). "Nicholas Minorsky and the automatic
+ * steering of ships". IEEE Control Systems Magazine. 4 (4): 10-15.
+ *
+ * @param linearSpeed   Target linear velocity in meters per second.
+ * @param yawError      Angular error in radians.
+ * @param measuredSpeed The rover's speed from odometry, meters per second.
+ * @param manual        Scale the command straight to the motors.
+ * @param left, right   The motor commands, -255 to 255.
+ */
+void DriveController::update(float linearSpeed, float yawError, float measuredSpeed, bool manual, int& left, int& right) {
+  // the controllers run on the measured time between commands, so mobility
+  // can send them at any rate without retuning
+  ros::Time now = ros::Time::now();
+  float dt = prevCommandTime.isZero() ? 0 : (now - prevCommandTime).toSec();
+  prevCommandTime = now;
+  if (dt <= 0 || dt > maxDriveCommandGap) {
+    velocityPID.reset();
+    yawPID.reset();
+    dt = nominalDriveInterval;
+  }
+
+  // if linear velocity setpoint changes reset integral and history to zero
+  if (linearSpeed != prevLin) {
+    velocityPID.reset();
+    prevLin = linearSpeed;
+  }
+
+  // if yaw error changes sign reset yaw integral and yaw-error history to zero
+  if ((prevYaw > 0 && yawError < 0) || (prevYaw < 0 && yawError > 0)) {
+    yawPID.reset();
+  }
+  prevYaw = yawError;
+
+  float velOut = 0;
+  float yawOut = 0;
+
+  if (manual) {
+    // scale values between -255 and 255
+    velOut = clamp(linearSpeed * sat, -sat, sat);
+    yawOut = clamp(yawError * sat, -sat, sat);
+  } else {
+    // Feed Forward command: a direct mapping of commanded linear velocity
+    // to a PWM (Pulse Width Modulation) value command for the motors
+    float velFF = 0;
+    if (linearSpeed > 0.5) velFF = 255;
+    else if (linearSpeed > 0.4) velFF = 180;
+    else if (linearSpeed > 0.3) velFF = 130;
+    else if (linearSpeed > 0.2) velFF = 75;
+    else if (linearSpeed > 0.1) velFF = 40;
+    else if (linearSpeed > 0.0) velFF = 10;
+
+    velOut = clamp(velocityPID.updateError(linearSpeed - measuredSpeed, dt) + velFF, -sat, sat);
+    yawOut = yawPID.updateError(yawError, dt);
+
+    // never drive against the commanded direction
+    if (linearSpeed > 0 && velOut < 0) velOut = 0;
+    else if (linearSpeed < 0 && velOut > 0) velOut = 0;
+
+    if (yawError > 0 && yawOut < 0) yawOut = 0;
+    else if (yawError < 0 && yawOut > 0) yawOut = 0;
+  }
+
+  left = clamp(velOut - yawOut, -sat, sat);
+  right = clamp(velOut + yawOut, -sat, sat);
+
+  if (linearSpeed == 0 && yawError == 0) {
+    left = 0;
+    right = 0;
+  }
+}
@@ -0,0 +1,164 @@
+#include "pid_controller/PIDController.h"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Settings with every gain and limit at zero and all of the optional
+ * behaviour switched off; callers fill in what they use.
+ */
+PIDController::PIDSettings::PIDSettings() {
+  Kp = 0;
+  Ki = 0;
+  Kd = 0;
+  dt = 0;
+  max = 0;
+  min = 0;
+  antiWindup = false;
+  integralMax = 0;
+  integralDeadband = 0;
+  derivativeFilter = 0;
+}
+
+/**
+ * The default constructor; by design, if a PIDController is not instantiated
+ * with a non-default constructor or initialized via setPIDControllerSettings()
+ * then "isInitialized" will be false and an error should occur.
+ */
+PIDController::PIDController() {
+  isInitialized = false;
+}
+
+/**
+ * Constructor; this function initializes most values using the provided
+ * PIDSettings structure and all others are set to default starting values.
+ *
+ * @param settings A PIDSettings struct defining dt, max, min, Kp, Kd, Ki and
+ *                 the optional anti-windup, integral and derivative settings.
+ */
+PIDController::PIDController(PIDController::PIDSettings settings) {
+  // fatal error check; if the dt value is invalid, exit and/or crash the sim
+  // especially if dt = 0, which would cause division by zero errors in the
+  // update() function
+  if(settings.dt <= 0.0) {
+    ROS_ERROR_STREAM(
+      "[PID Controller]: In PIDController.cpp: PIDController(PIDSettings): "
+      << "dt = " << settings.dt << ", dt cannot be <= 0.0"
+    );
+    exit(1);
+  }
+
+  isInitialized = true;
+  dt  = settings.dt;
+  max = settings.max;
+  min = settings.min;
+  Kp = settings.Kp;
+  Kd = settings.Kd;
+  Ki = settings.Ki;
+  antiWindup = settings.antiWindup;
+  integralMax = settings.integralMax;
+  integralDeadband = settings.integralDeadband;
+  derivativeFilter = settings.derivativeFilter;
+  reset();
+}
+
+/**
+ * This function calculates the amount of force in Newtons to apply to a joint.
+ * The farther away a joint is from its desired position, the more force that
+ * will be applied. The sign of the value returned from this function matters
+ * as it will determine the direction of the applied force. The amount of force
+ * issued is limited by the "min" and "max" variables defined in this class.
+ *
+ * @param setPoint     The desired value we are trying to achieve and maintain.
+ * @pram  currentValue The current value.
+ * @return The amount of force in Newtons to be applied to a joint to move
+ *         closer to the setPoint from the currentValue.
+ */
+float PIDController::update(float setPoint, float currentValue) {
+  return updateError(setPoint - currentValue, dt);
+}
+
+/**
+ * As update(setPoint, currentValue), for a controller that is not updated at
+ * a fixed rate.
+ *
+ * @param dt The time in seconds since the last update.
+ */
+float PIDController::update(float setPoint, float currentValue, float dt) {
+  return updateError(setPoint - currentValue, dt);
+}
+
+/**
+ * The controller itself.
+ *
+ * @param error The setpoint minus the current value.
+ * @param dt    The time in seconds since the last update; an update with no
+ *              time elapsed only refreshes the proportional term.
+ * @return The controller output, limited to min and max.
+ */
+float PIDController::updateError(float error, float dt) {
+  if(isInitialized == false) {
+    ROS_ERROR_STREAM(
+      "[PID Controller]: In PIDController.cpp: updateError(): PIDController "
+      << "was not properly initialized before its first update!"
+    );
+    exit(1);
+  }
+
+  // Calculate the proportional term: the amount to adjust according to the
+  // difference between the desired value and the actual value.
+  float proportionalTerm = Kp*error;
+
+  // Calculate the derivative term: the amount to adjust according to the rate
+  // at which the difference between the desired value and the actual value is
+  // changing. The first update after a reset has nothing to compare against.
+  if(dt > 0 && hasPreviousError) {
+    float rate = (error - previousError)/dt;
+    if(derivativeFilter > 0) {
+      derivative += dt/(derivativeFilter + dt)*(rate - derivative);
+    } else {
+      derivative = rate;
+    }
+  }
+  float derivativeTerm = Kd*derivative;
+
+  // Calculate the integral term: the amount to adjust based on the total error
+  // seen so far.
+  float previousIntegral = integral;
+  if(dt > 0 && fabs(error) >= integralDeadband) {
+    integral += (error*dt);
+  }
+  if(integralMax > 0 && Ki != 0 && fabs(Ki*integral) > integralMax) {
+    integral = (Ki*integral > 0 ? integralMax : -integralMax)/Ki;
+  }
+  float integralTerm = Ki*integral;
+
+  // Sum all of the terms.
+  float output = proportionalTerm + derivativeTerm + integralTerm;
+
+  // Check the bounds for the maximum and minimum forces. While the output is
+  // pinned, integrating error that pushes it further out only winds up the
+  // integral, so that step is taken back.
+  if(output > max) {
+    if(antiWindup && error > 0) integral = previousIntegral;
+    output = max;
+  } else if(output < min) {
+    if(antiWindup && error < 0) integral = previousIntegral;
+    output = min;
+  }
+
+  // Record the error for the derivative calculation.
+  previousError = error;
+  hasPreviousError = true;
+
+  return output;
+}
+
+void PIDController::reset() {
+  previousError = 0;
+  hasPreviousError = false;
+  derivative = 0;
+  integral = 0;
+}
@@ -1,54 +1,103 @@
 #include "sbridge.h"
+#include <cmath>
+
+namespace {
+
+const float sat = DriveController::SATURATION;
+const float maxSlewGap = 0.5; // a longer gap between timer ticks (the sim paused) is skipped, not slewed across
+
+float clamp(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+}
 
 sbridge::sbridge(std::string publishedName) {
     ros::NodeHandle param("~");
     ros::NodeHandle sNH;
 
+    // the same drive loop, with the same params, as abridge
+    driveController = DriveController(param);
+
+    // the wheel separation is the skid steer plugin's; full speed is about
+    // where abridge's feed forward table puts a command of 255
+    param.param("wheelSeparation", wheelSeparation, 0.27f);
+    param.param("maxWheelSpeed", maxWheelSpeed, 0.6f);
+    param.param("maxAcceleration", maxAcceleration, 1.0f);
+    param.param("maxJerk", maxJerk, 5.0f);
+    double publishRate;
+    param.param("publishRate", publishRate, 50.0);
+    if (publishRate <= 0) publishRate = 50.0;
+
+    measuredVelocity = 0;
+    currentMode = 0;
+    leftTarget = 0;
+    rightTarget = 0;
+    leftSpeed = 0;
+    rightSpeed = 0;
+    leftAcceleration = 0;
+    rightAcceleration = 0;
+
     driveControlSubscriber = sNH.subscribe((publishedName + "/driveControl"), 10, &sbridge::cmdHandler, this);
+    odometrySubscriber = sNH.subscribe((publishedName + "/odom"), 10, &sbridge::odometryHandler, this);
+    modeSubscriber = sNH.subscribe((publishedName + "/mode"), 1, &sbridge::modeHandler, this);
     skidsteerPublish = sNH.advertise<geometry_msgs::Twist>((publishedName + "/skidsteer"), 10);
+    skidsteerTimer = sNH.createTimer(ros::Duration(1.0 / publishRate), &sbridge::publishTimer, this);
+}
+
+void sbridge::odometryHandler(const nav_msgs::Odometry::ConstPtr& message) {
+    float xVel = message->twist.twist.linear.x;
+    float yVel = message->twist.twist.linear.y;
+    measuredVelocity = sqrt(xVel*xVel + yVel*yVel);
+}
+
+void sbridge::modeHandler(const std_msgs::UInt8::ConstPtr& message) {
+    currentMode = message->data;
 }
 
+// abridge's driveCommandHandler, down to the motor commands
 void sbridge::cmdHandler(const geometry_msgs::Twist::ConstPtr& message) {
-    double linearVel = (message->linear.x);
-    double angularVel = (message->angular.z);
-    int sat = 255;
-    int Kpv = 255;
-    int Kpa = 200;
-
-    //Propotinal
-    float PV = Kpv * linearVel;
-    if (PV > sat) //limit the max and minimum output of proportinal
-        PV = sat;
-    if (PV < -sat)
-        PV= -sat;
-
-    //Propotinal
-    float PA = Kpa * angularVel;
-    if (PA > sat) //limit the max and minimum output of proportinal
-        PA = sat;
-    if (PA < -sat)
-        PA= -sat;
-
-    float turn = PA/60;
-    float forward = PV/355;
-
-    if (forward >= 150){
-
-        forward -= (abs(turn)/5);
-    }
+    int left, right;
+    driveController.update(message->linear.x, message->angular.z, measuredVelocity, currentMode == 1, left, right);
 
-    if (linearVel >= 0 && forward <= 0)
-    {
-        forward = 0;
-    }
-    if (linearVel <= 0 && forward >= 0)
-    {
-        forward = 0;
-    }
-   
+    leftTarget = left / sat * maxWheelSpeed;
+    rightTarget = right / sat * maxWheelSpeed;
+}
+
+void sbridge::publishTimer(const ros::TimerEvent& event) {
+    ros::Time now = ros::Time::now();
+    float dt = (now - prevSlewTime).toSec();
+    prevSlewTime = now;
+    if (dt <= 0 || dt > maxSlewGap) return;
+
+    slew(leftTarget, leftSpeed, leftAcceleration, dt);
+    slew(rightTarget, rightSpeed, rightAcceleration, dt);
 
-    velocity.linear.x = forward,
-            velocity.angular.z = turn;
+    // differential drive: the body velocity that turns the wheels at these speeds
+    velocity.linear.x = (leftSpeed + rightSpeed) / 2;
+    velocity.angular.z = (rightSpeed - leftSpeed) / wheelSeparation;
     skidsteerPublish.publish(velocity);
 }
 
+void sbridge::slew(float target, float& speed, float& acceleration, float dt) {
+    float error = target - speed;
+    float desired = error / dt;
+
+    if (maxAcceleration > 0) desired = clamp(desired, -maxAcceleration, maxAcceleration);
+
+    if (maxJerk > 0) {
+        // no harder than can be eased off again by the time target is reached
+        float easeOff = sqrt(2 * maxJerk * fabs(error));
+        desired = clamp(desired, -easeOff, easeOff);
+        desired = clamp(desired, acceleration - maxJerk * dt, acceleration + maxJerk * dt);
+    }
+
+    acceleration = desired;
+    float step = acceleration * dt;
+    // never past the target; once there, the wheel holds its speed
+    if ((error >= 0 && step > error) || (error <= 0 && step < error)) {
+        step = error;
+        acceleration = 0;
+    }
+    speed += step;
+}
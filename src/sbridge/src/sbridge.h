@@ -8,13 +8,23 @@
 #include <geometry_msgs/Quaternion.h>
 #include <geometry_msgs/QuaternionStamped.h>
 #include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
 #include <std_msgs/UInt8.h>
 
+#include <pid_controller/DriveController.h>
+
 using namespace std;
 
 /**
  * This class translates drive controls into Gazebo
  * friendly velocities.
+ *
+ * It runs the same DriveController abridge runs on the physical rover, on
+ * the simulated odometry, giving left and right motor commands from -255 to
+ * 255. Those are turned
+ * into wheel speeds, limited in acceleration and jerk the way the motors
+ * are, and sent to the skid steer plugin as the differential drive body
+ * velocity that produces them.
  */
 class sbridge {
 
@@ -22,16 +32,46 @@ class sbridge {
 
 		sbridge(std::string publishedName);
 		void cmdHandler(const geometry_msgs::Twist::ConstPtr& message);
+		void odometryHandler(const nav_msgs::Odometry::ConstPtr& message);
+		void modeHandler(const std_msgs::UInt8::ConstPtr& message);
+		void publishTimer(const ros::TimerEvent& event);
 
 	private:
 
+		// moves speed toward target within the acceleration and jerk limits
+		void slew(float target, float& speed, float& acceleration, float dt);
+
 		//Publishers
 		ros::Publisher skidsteerPublish;
 
 		//Subscribers
 		ros::Subscriber driveControlSubscriber;
+		ros::Subscriber odometrySubscriber;
+		ros::Subscriber modeSubscriber;
+
+		ros::Timer skidsteerTimer;
 
 		geometry_msgs::Twist velocity;
+
+		// drive loop, shared with abridge
+		DriveController driveController;
+		float measuredVelocity;
+		int currentMode; // 1 is manual: commands map straight to the motors
+
+		// rover model
+		float wheelSeparation; // meters between the left and right wheels
+		float maxWheelSpeed;   // meters per second at a motor command of 255
+		float maxAcceleration; // meters per second squared, 0 for no limit
+		float maxJerk;         // meters per second cubed, 0 for no limit
+
+		// wheel speeds the drive loop asks for, and what the wheels are doing
+		float leftTarget;
+		float rightTarget;
+		float leftSpeed;
+		float rightSpeed;
+		float leftAcceleration;
+		float rightAcceleration;
+		ros::Time prevSlewTime;
 };
 
 #endif /* SBRIDGE */
@@ -240,6 +240,14 @@ void Gps::readCallback(unsigned char *data, std::size_t& size) {
   ublox::Reader reader(data, size);
 
   while(reader.search() != reader.end() && reader.found()) {
+    // a frame that fails its checksum goes to no handler, and its length
+    // can't be trusted to skip it by
+    if (!reader.valid()) {
+      if (debug >= 2) std::cout << "ublox checksum error, class " << static_cast<unsigned int>(reader.classId()) << " id " << static_cast<unsigned int>(reader.messageId()) << std::endl;
+      reader.discard();
+      continue;
+    }
+
     if (debug >= 3) {
       std::cout << "received ublox " << reader.length() + 8 << " bytes" << std::endl;
       for(ublox::Reader::iterator it = reader.pos(); it != reader.pos() + reader.length() + 8; ++it) std::cout << std::hex << static_cast<unsigned int>(*it) << " ";
@@ -33,6 +33,7 @@
 #include <boost/call_traits.hpp>
 #include <vector>
 #include <algorithm>
+#include <string.h>
 
 #include "checksum.h"
 
@@ -76,7 +77,7 @@ struct Options
 
 class Reader {
 public:
-  Reader(const uint8_t *data, uint32_t count, const Options &options = Options()) : data_(data), count_(count), found_(false), options_(options) {}
+  Reader(const uint8_t *data, uint32_t count, const Options &options = Options()) : data_(data), count_(count), found_(false), checked_(false), valid_(false), options_(options) {}
 
   typedef const uint8_t *iterator;
 
@@ -84,8 +85,19 @@ public:
   {
     if (found_) next();
 
-    for( ; count_ > 0; --count_, ++data_) {
-      if (data_[0] == options_.sync_a && (count_ == 1 || data_[1] == options_.sync_b)) break;
+    // memchr skips to each candidate first sync byte a word or more at a time
+    while (count_ > 0) {
+      const uint8_t *sync = static_cast<const uint8_t *>(memchr(data_, options_.sync_a, count_));
+      if (!sync) {
+        data_ += count_;
+        count_ = 0;
+        break;
+      }
+
+      count_ -= sync - data_;
+      data_ = sync;
+      if (count_ == 1 || data_[1] == options_.sync_b) break;
+      ++data_; --count_;
     }
 
     return data_;
@@ -108,9 +120,32 @@ public:
       data_ += size; count_ -= size;
     }
     found_ = false;
+    checked_ = false;
     return data_;
   }
 
+  // steps over the sync word of a frame that turned out to be bad, without
+  // trusting its length
+  iterator discard() {
+    if (count_ > 0) { ++data_; --count_; }
+    found_ = false;
+    checked_ = false;
+    return data_;
+  }
+
+  // whether the checksum of the found frame matches; it is worked out once
+  // per frame, however many handlers read it
+  bool valid()
+  {
+    if (!found()) return false;
+    if (!checked_) {
+      uint16_t chk;
+      valid_ = (calculateChecksum(data_ + 2, length() + 4, chk) == this->checksum());
+      checked_ = true;
+    }
+    return valid_;
+  }
+
   iterator pos() {
     return data_;
   }
@@ -132,8 +167,7 @@ public:
     if (!found()) return false;
     if (!Message<T>::canDecode(classId(), messageId())) return false;
 
-    uint16_t chk;
-    if (calculateChecksum(data_ + 2, length() + 4, chk) != this->checksum()) {
+    if (!valid()) {
       // checksum error
       return false;
     }
@@ -158,6 +192,8 @@ private:
   const uint8_t *data_;
   uint32_t count_;
   bool found_;
+  bool checked_; // valid_ holds the checksum result for the found frame
+  bool valid_;
   Options options_;
 };
 
@@ -0,0 +1,120 @@
+// Times the Reader's scan for frames, the way Gps::readCallback drives it,
+// against the byte at a time search it had before it used memchr. The stream
+// is synthetic: UBX frames between runs of junk with stray 0xB5 bytes in it,
+// and every tenth frame with a bad checksum.
+#include <ublox/serialization.h>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace {
+
+const uint8_t sync_a = 0xB5, sync_b = 0x62;
+
+bool hasSyncWord(const uint8_t *data, size_t count) {
+  for (size_t i = 0; i + 1 < count; ++i) {
+    if (data[i] == sync_a && data[i + 1] == sync_b) return true;
+  }
+  return false;
+}
+
+// a bad frame is stepped over by its sync byte alone, so there must be no
+// sync word inside it or the scan would go looking for a frame there
+void buildStream(std::vector<uint8_t>& stream, size_t size, unsigned long& good, unsigned long& bad) {
+  good = 0;
+  bad = 0;
+  srand(1);
+  while (stream.size() < size) {
+    int junk = rand() % 200;
+    for (int i = 0; i < junk; ++i) {
+      uint8_t byte = rand() % 20 == 0 ? sync_a : rand() % 256;
+      if (byte == sync_b && !stream.empty() && stream.back() == sync_a) byte = 0;
+      stream.push_back(byte);
+    }
+
+    bool corrupt = (good + bad) % 10 == 9;
+    std::vector<uint8_t> frame;
+    do {
+      uint32_t length = rand() % 100;
+      std::vector<uint8_t> payload(length + 1);
+      for (uint32_t i = 0; i < length; ++i) payload[i] = rand() % 256;
+      frame.resize(length + 8);
+      ublox::Writer writer(&frame[0], frame.size());
+      writer.write(&payload[0], length, 0x01, 0x07);
+      if (corrupt) frame[frame.size() - 1] ^= 0x01;
+    } while (corrupt && hasSyncWord(&frame[1], frame.size() - 1));
+
+    stream.insert(stream.end(), frame.begin(), frame.end());
+    if (corrupt) bad++;
+    else good++;
+  }
+}
+
+unsigned long scanReader(const std::vector<uint8_t>& stream) {
+  unsigned long frames = 0;
+  ublox::Reader reader(&stream[0], stream.size());
+  while (reader.search() != reader.end() && reader.found()) {
+    if (!reader.valid()) {
+      reader.discard();
+      continue;
+    }
+    frames++;
+  }
+  return frames;
+}
+
+// Reader::search() as it was, with the same found, valid and discard steps
+unsigned long scanByteLoop(const std::vector<uint8_t>& stream) {
+  unsigned long frames = 0;
+  const uint8_t *data = &stream[0];
+  uint32_t count = stream.size();
+  for (;;) {
+    for ( ; count > 0; --count, ++data) {
+      if (data[0] == sync_a && (count == 1 || data[1] == sync_b)) break;
+    }
+    if (count < 6) break;
+    uint32_t length = (data[5] << 8) + data[4];
+    if (count < length + 8) break;
+
+    uint16_t chk;
+    if (ublox::calculateChecksum(data + 2, length + 4, chk) != *reinterpret_cast<const uint16_t *>(data + 6 + length)) {
+      ++data; --count;
+      continue;
+    }
+    frames++;
+    data += length + 8; count -= length + 8;
+  }
+  return frames;
+}
+
+double timeScan(unsigned long (*scan)(const std::vector<uint8_t>&), const std::vector<uint8_t>& stream, int passes, unsigned long& frames) {
+  clock_t start = clock();
+  for (int i = 0; i < passes; ++i) frames = scan(stream);
+  return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int passes = argc > 1 ? atoi(argv[1]) : 50;
+  if (passes < 1) passes = 1;
+
+  std::vector<uint8_t> stream;
+  unsigned long good, bad;
+  buildStream(stream, 4 << 20, good, bad);
+
+  unsigned long readerFrames, byteLoopFrames;
+  double byteLoopSeconds = timeScan(scanByteLoop, stream, passes, byteLoopFrames);
+  double readerSeconds = timeScan(scanReader, stream, passes, readerFrames);
+
+  double megabytes = double(stream.size()) * passes / (1 << 20);
+  printf("%lu bytes, %lu good frames, %lu bad, %d passes\n", (unsigned long)stream.size(), good, bad, passes);
+  printf("byte loop: %lu frames, %.1f MB/s\n", byteLoopFrames, megabytes / byteLoopSeconds);
+  printf("memchr:    %lu frames, %.1f MB/s\n", readerFrames, megabytes / readerSeconds);
+
+  if (readerFrames != good || byteLoopFrames != good) {
+    printf("frame counts do not match the stream\n");
+    return 1;
+  }
+  return 0;
+}
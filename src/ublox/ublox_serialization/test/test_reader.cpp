@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <ublox/serialization.h>
+
+namespace {
+
+// appends a frame of class 0x01, id 0x07 with length payload bytes
+void appendFrame(std::vector<uint8_t>& stream, uint32_t length, uint8_t fill = 0x11) {
+  std::vector<uint8_t> payload(length, fill);
+  std::vector<uint8_t> frame(length + 8);
+  ublox::Writer writer(&frame[0], frame.size());
+  writer.write(length ? &payload[0] : 0, length, 0x01, 0x07);
+  stream.insert(stream.end(), frame.begin(), frame.end());
+}
+
+void appendBytes(std::vector<uint8_t>& stream, const uint8_t* bytes, size_t count) {
+  stream.insert(stream.end(), bytes, bytes + count);
+}
+
+} // namespace
+
+TEST(Reader, JunkOnly) {
+  const uint8_t junk[] = {0x00, 0x62, 0x13, 0xB4, 0xFF, 0x62, 0x01};
+  ublox::Reader reader(junk, sizeof(junk));
+
+  EXPECT_EQ(reader.end(), reader.search());
+  EXPECT_FALSE(reader.found());
+}
+
+TEST(Reader, FrameAfterJunkWithStraySyncBytes) {
+  // 0xB5 alone, and 0xB5 followed by anything but 0x62, is not a frame
+  const uint8_t junk[] = {0x42, 0xB5, 0x00, 0xB5, 0xB5, 0x61, 0x07};
+  std::vector<uint8_t> stream;
+  appendBytes(stream, junk, sizeof(junk));
+  appendFrame(stream, 4);
+
+  ublox::Reader reader(&stream[0], stream.size());
+  EXPECT_EQ(&stream[sizeof(junk)], reader.search());
+  ASSERT_TRUE(reader.found());
+  EXPECT_TRUE(reader.valid());
+  EXPECT_TRUE(reader.isMessage(0x01, 0x07));
+  EXPECT_EQ(4u, reader.length());
+
+  EXPECT_EQ(reader.end(), reader.search());
+  EXPECT_FALSE(reader.found());
+}
+
+TEST(Reader, LoneTrailingSyncByteIsKept) {
+  std::vector<uint8_t> stream;
+  appendFrame(stream, 2);
+  stream.push_back(0xB5);
+
+  ublox::Reader reader(&stream[0], stream.size());
+  reader.search();
+  ASSERT_TRUE(reader.found());
+
+  // the 0x62 may be in the next read, so the scan stops on the 0xB5 and
+  // readCallback keeps it
+  EXPECT_EQ(&stream[stream.size() - 1], reader.search());
+  EXPECT_FALSE(reader.found());
+  EXPECT_EQ(reader.end() - 1, reader.pos());
+}
+
+TEST(Reader, IncompleteFrameIsNotFound) {
+  std::vector<uint8_t> stream;
+  appendFrame(stream, 6);
+  stream.pop_back();
+
+  ublox::Reader reader(&stream[0], stream.size());
+  EXPECT_EQ(&stream[0], reader.search());
+  EXPECT_FALSE(reader.found());
+  EXPECT_FALSE(reader.valid());
+}
+
+TEST(Reader, CorruptedFrameIsDiscardedByItsSyncByte) {
+  std::vector<uint8_t> stream;
+  appendFrame(stream, 8);
+  size_t second = stream.size();
+  appendFrame(stream, 3, 0x22);
+  stream[6 + 2] ^= 0x40; // a payload byte of the first frame
+
+  ublox::Reader reader(&stream[0], stream.size());
+  reader.search();
+  ASSERT_TRUE(reader.found());
+  EXPECT_FALSE(reader.valid());
+  EXPECT_FALSE(reader.valid()); // cached, and still false
+
+  EXPECT_EQ(&stream[1], reader.discard());
+  EXPECT_EQ(&stream[second], reader.search());
+  ASSERT_TRUE(reader.found());
+  EXPECT_TRUE(reader.valid());
+  EXPECT_EQ(3u, reader.length());
+}
+
+TEST(Reader, CorruptedLengthDoesNotHideTheNextFrame) {
+  std::vector<uint8_t> stream;
+  appendFrame(stream, 2);
+  size_t second = stream.size();
+  appendFrame(stream, 2, 0x22);
+  appendFrame(stream, 2, 0x33);
+  stream[4] = 12; // the first frame now claims to run over the second
+
+  ublox::Reader reader(&stream[0], stream.size());
+  reader.search();
+  ASSERT_TRUE(reader.found());
+  EXPECT_FALSE(reader.valid());
+
+  reader.discard();
+  EXPECT_EQ(&stream[second], reader.search());
+  ASSERT_TRUE(reader.found());
+  EXPECT_TRUE(reader.valid());
+  EXPECT_EQ(0x22, reader.data()[0]);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}